@@ -0,0 +1,16 @@
+#include <chrono>
+#include <Arduino.h>
+
+using Clock = std::chrono::steady_clock;
+
+static const Clock::time_point startTime = Clock::now();
+
+uint32_t micros()
+{
+    return (uint32_t) std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - startTime).count();
+}
+
+uint32_t millis()
+{
+    return (uint32_t) std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - startTime).count();
+}
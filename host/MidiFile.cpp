@@ -0,0 +1,204 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include "MidiFile.h"
+
+constexpr uint8_t TempoMeta = 0x51;
+constexpr uint32_t DefaultTempo = 500000; // 120 bpm
+
+static uint32_t readBE(const uint8_t* p, size_t numBytes)
+{
+    uint32_t x = 0;
+
+    for (size_t i = 0; i < numBytes; ++i)
+        x = (x << 8) | p[i];
+
+    return x;
+}
+
+static bool readVarLen(const uint8_t*& p, const uint8_t* end, uint32_t& value)
+{
+    value = 0;
+
+    for (int i = 0; i < 4; ++i) {
+        if (p >= end)
+            return false;
+
+        const uint8_t b = *p++;
+        value = (value << 7) | (b & 0x7F);
+
+        if ((b & 0x80) == 0)
+            return true;
+    }
+
+    return false;
+}
+
+//==============================================================================
+
+bool MidiFile::load(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+
+    if (! file)
+        return fail("Unable to open " + path);
+
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)),
+                              std::istreambuf_iterator<char>());
+
+    m_trackEvents.clear();
+    m_events.clear();
+    m_error.clear();
+
+    if (! parse(data))
+        return false;
+
+    resolveTime();
+    return true;
+}
+
+double MidiFile::duration() const noexcept
+{
+    return m_events.empty() ? 0.0 : m_events.back().time;
+}
+
+bool MidiFile::parse(const std::vector<uint8_t>& data)
+{
+    const uint8_t* p = data.data();
+    const uint8_t* end = p + data.size();
+
+    if (data.size() < 14 || ::memcmp(p, "MThd", 4) != 0)
+        return fail("Not a Standard MIDI File");
+
+    const uint32_t headerSize = readBE(p + 4, 4);
+    const uint16_t format = readBE(p + 8, 2);
+    const uint16_t numTracks = readBE(p + 10, 2);
+    m_division = readBE(p + 12, 2);
+
+    if (format > 1)
+        return fail("Only MIDI file formats 0 and 1 are supported");
+
+    if (m_division & 0x8000)
+        return fail("SMPTE time division is not supported");
+
+    p += 8 + headerSize;
+
+    for (int track = 0; track < numTracks; ++track) {
+        if (end - p < 8)
+            return fail("Truncated MIDI file");
+
+        const uint32_t chunkSize = readBE(p + 4, 4);
+        const bool isTrack = ::memcmp(p, "MTrk", 4) == 0;
+        p += 8;
+
+        if ((size_t)(end - p) < chunkSize)
+            return fail("Truncated track chunk");
+
+        if (isTrack && ! parseTrack(p, chunkSize))
+            return false;
+
+        p += chunkSize;
+    }
+
+    return true;
+}
+
+bool MidiFile::parseTrack(const uint8_t* p, size_t size)
+{
+    const uint8_t* end = p + size;
+    uint64_t tick = 0;
+    uint8_t runningStatus = 0;
+
+    while (p < end) {
+        uint32_t delta = 0;
+
+        if (! readVarLen(p, end, delta))
+            return fail("Malformed delta time");
+
+        tick += delta;
+
+        if (p >= end)
+            return fail("Truncated event");
+
+        uint8_t status = *p;
+
+        if (status & 0x80)
+            ++p;
+        else if (runningStatus != 0)
+            status = runningStatus;
+        else
+            return fail("Running status without a preceding status byte");
+
+        if (status == 0xFF) {
+            // Meta event
+            if (p >= end)
+                return fail("Truncated meta event");
+
+            const uint8_t type = *p++;
+            uint32_t length = 0;
+
+            if (! readVarLen(p, end, length) || (size_t)(end - p) < length)
+                return fail("Truncated meta event");
+
+            if (type == TempoMeta && length == 3)
+                m_trackEvents.push_back({ tick, status, 0, 0, readBE(p, 3) });
+
+            p += length;
+            runningStatus = 0;
+        } else if (status == 0xF0 || status == 0xF7) {
+            // SysEx is skipped
+            uint32_t length = 0;
+
+            if (! readVarLen(p, end, length) || (size_t)(end - p) < length)
+                return fail("Truncated SysEx event");
+
+            p += length;
+            runningStatus = 0;
+        } else {
+            const uint8_t type = status & 0xF0;
+            const size_t numData = (type == 0xC0 || type == 0xD0) ? 1 : 2;
+
+            if ((size_t)(end - p) < numData)
+                return fail("Truncated channel event");
+
+            const uint8_t data1 = p[0] & 0x7F;
+            const uint8_t data2 = numData > 1 ? (p[1] & 0x7F) : 0;
+            p += numData;
+            runningStatus = status;
+
+            m_trackEvents.push_back({ tick, status, data1, data2, 0 });
+        }
+    }
+
+    return true;
+}
+
+void MidiFile::resolveTime()
+{
+    // Merge the tracks keeping the original order of simultaneous events.
+    std::stable_sort(m_trackEvents.begin(), m_trackEvents.end(),
+        [](const TrackEvent& a, const TrackEvent& b) {
+            return a.tick < b.tick;
+        });
+
+    uint64_t lastTick = 0;
+    double time = 0.0;
+    double secondsPerTick = DefaultTempo * 1e-6 / m_division;
+
+    for (const auto& e : m_trackEvents) {
+        time += (e.tick - lastTick) * secondsPerTick;
+        lastTick = e.tick;
+
+        if (e.status == 0xFF)
+            secondsPerTick = e.tempo * 1e-6 / m_division;
+        else
+            m_events.push_back({ time, e.status, e.data1, e.data2 });
+    }
+}
+
+bool MidiFile::fail(const std::string& message)
+{
+    m_error = message;
+    return false;
+}
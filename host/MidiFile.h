@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Standard MIDI File reader.
+ *
+ * Loads format 0 and 1 files, merges all the tracks and
+ * resolves the tempo map, so that every channel message
+ * gets an absolute time stamp in seconds.
+ */
+class MidiFile
+{
+public:
+
+    struct Event
+    {
+        double time;        // [s]
+        uint8_t status;     // Status byte, including the channel
+        uint8_t data1;
+        uint8_t data2;
+    };
+
+    bool load(const std::string& path);
+
+    const std::vector<Event>& events() const noexcept { return m_events; }
+    const std::string& error() const noexcept { return m_error; }
+
+    /// Time of the last event [s]
+    double duration() const noexcept;
+
+private:
+
+    bool parse(const std::vector<uint8_t>& data);
+    bool parseTrack(const uint8_t* data, size_t size);
+    void resolveTime();
+
+    bool fail(const std::string& message);
+
+    struct TrackEvent
+    {
+        uint64_t tick;
+        uint8_t status;
+        uint8_t data1;
+        uint8_t data2;
+        uint32_t tempo;     // [us per quarter note], tempo meta events only
+    };
+
+    std::vector<TrackEvent> m_trackEvents;
+    std::vector<Event> m_events;
+    std::string m_error;
+    uint16_t m_division = 480;
+};
@@ -0,0 +1,84 @@
+#include "WavWriter.h"
+
+constexpr uint16_t NumChannels = 2;
+constexpr uint16_t BitsPerSample = 16;
+constexpr uint16_t BytesPerFrame = NumChannels * BitsPerSample / 8;
+
+static void put16(FILE* f, uint16_t x)
+{
+    const uint8_t b[2] = { uint8_t(x), uint8_t(x >> 8) };
+    fwrite(b, 1, sizeof(b), f);
+}
+
+static void put32(FILE* f, uint32_t x)
+{
+    const uint8_t b[4] = { uint8_t(x), uint8_t(x >> 8), uint8_t(x >> 16), uint8_t(x >> 24) };
+    fwrite(b, 1, sizeof(b), f);
+}
+
+WavWriter::~WavWriter()
+{
+    close();
+}
+
+bool WavWriter::open(const std::string& path, uint32_t sampleRate)
+{
+    close();
+
+    m_file = fopen(path.c_str(), "wb");
+
+    if (m_file == nullptr)
+        return false;
+
+    m_sampleRate = sampleRate;
+    m_numFrames = 0;
+
+    // Placeholder, rewritten with actual sizes on close.
+    writeHeader();
+
+    return true;
+}
+
+void WavWriter::close()
+{
+    if (m_file == nullptr)
+        return;
+
+    fseek(m_file, 0, SEEK_SET);
+    writeHeader();
+    fclose(m_file);
+    m_file = nullptr;
+}
+
+bool WavWriter::write(const int16_t* interleaved, size_t numFrames)
+{
+    if (m_file == nullptr)
+        return false;
+
+    // WAV is little-endian, as are all the hosts we build on.
+    const size_t written = fwrite(interleaved, BytesPerFrame, numFrames, m_file);
+    m_numFrames += written;
+
+    return written == numFrames;
+}
+
+void WavWriter::writeHeader()
+{
+    const uint32_t dataSize = m_numFrames * BytesPerFrame;
+
+    fwrite("RIFF", 1, 4, m_file);
+    put32(m_file, 36 + dataSize);
+    fwrite("WAVE", 1, 4, m_file);
+
+    fwrite("fmt ", 1, 4, m_file);
+    put32(m_file, 16);
+    put16(m_file, 1); // PCM
+    put16(m_file, NumChannels);
+    put32(m_file, m_sampleRate);
+    put32(m_file, m_sampleRate * BytesPerFrame);
+    put16(m_file, BytesPerFrame);
+    put16(m_file, BitsPerSample);
+
+    fwrite("data", 1, 4, m_file);
+    put32(m_file, dataSize);
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+/**
+ * @brief Stereo 16-bit PCM WAV file writer.
+ */
+class WavWriter
+{
+public:
+
+    WavWriter() = default;
+    ~WavWriter();
+
+    bool open(const std::string& path, uint32_t sampleRate);
+    void close();
+
+    /// Write interleaved stereo samples.
+    bool write(const int16_t* interleaved, size_t numFrames);
+
+private:
+
+    void writeHeader();
+
+    FILE* m_file = nullptr;
+    uint32_t m_sampleRate = 0;
+    uint32_t m_numFrames = 0;
+};
@@ -0,0 +1,29 @@
+/*
+ * Runs the DSP kernel micro-benchmarks on the host.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include "engine/Benchmark.h"
+
+static void printLine(const char* line)
+{
+    puts(line);
+}
+
+int main(int argc, char** argv)
+{
+    size_t numBlocks = bench::DefaultNumBlocks;
+
+    if (argc > 1)
+        numBlocks = (size_t) atol(argv[1]);
+
+    if (numBlocks == 0) {
+        fprintf(stderr, "Usage: %s [num_blocks]\n", argv[0]);
+        return 1;
+    }
+
+    bench::run(printLine, numBlocks);
+
+    return 0;
+}
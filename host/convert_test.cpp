@@ -0,0 +1,206 @@
+/*
+ * Output conversion test: the vectorised conversion to 16-bit samples
+ * must match the per sample conversion of the block output path, and
+ * the interleaved one the frames the I2S output builds from the blocks
+ * (memcpy_tointerleaveLR), bit for bit. The dithered and the 24-bit
+ * kernels must match their per sample references, and the dither must
+ * have the TPDF error statistics.
+ *
+ * Returns non-zero on failure.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <limits>
+#include "engine/Convert.h"
+
+constexpr size_t MaxFrames = 256;
+
+static int failures = 0;
+
+static void check(bool condition, size_t numFrames, const char* what)
+{
+    if (! condition) {
+        printf("FAILED %u frames: %s\n", (unsigned) numFrames, what);
+        failures += 1;
+    }
+}
+
+alignas(16) static float inL[MaxFrames];
+alignas(16) static float inR[MaxFrames];
+
+// Samples around the clipping and rounding edges, then noise beyond the full scale.
+static void prepareInput(uint32_t seed)
+{
+    static const float edges[] = {
+        0.0f, -0.0f, 1.0f, -1.0f, 1.0001f, -1.0001f, 0.99999994f, -0.99999994f,
+        1.0f / 32767.0f, -1.0f / 32767.0f, 0.5f / 32767.0f, -0.5f / 32767.0f,
+        std::numeric_limits<float>::denorm_min(), -std::numeric_limits<float>::denorm_min(),
+        std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity(),
+        1e30f, -1e30f
+    };
+
+    constexpr size_t numEdges = sizeof(edges) / sizeof(edges[0]);
+
+    for (size_t i = 0; i < MaxFrames; ++i) {
+        seed = seed * 1664525u + 1013904223u;
+        inL[i] = i < numEdges ? edges[i] : float(int32_t(seed)) * (1.5f / 2147483648.0f);
+        seed = seed * 1664525u + 1013904223u;
+        inR[i] = i < numEdges ? edges[numEdges - 1 - i] : float(int32_t(seed)) * (1.5f / 2147483648.0f);
+    }
+}
+
+static void test(size_t numFrames)
+{
+    // Block path, see AudioProcess::renderBlock()
+    int16_t refL[MaxFrames];
+    int16_t refR[MaxFrames];
+    float refPeakL = 0.0f;
+    float refPeakR = 0.0f;
+
+    for (size_t i = 0; i < numFrames; ++i) {
+        const float l = math::clamp(-1.0f, 1.0f, inL[i]);
+        const float r = math::clamp(-1.0f, 1.0f, inR[i]);
+
+        refPeakL = std::max(refPeakL, fabsf(l));
+        refPeakR = std::max(refPeakR, fabsf(r));
+
+        refL[i] = (int16_t) (l * 32767.0f);
+        refR[i] = (int16_t) (r * 32767.0f);
+    }
+
+    // I2S DMA buffer words, see memcpy_tointerleaveLR()
+    uint32_t refFrames[MaxFrames];
+
+    for (size_t i = 0; i < numFrames; ++i)
+        refFrames[i] = uint32_t(uint16_t(refL[i])) | (uint32_t(uint16_t(refR[i])) << 16);
+
+    int16_t outL[MaxFrames];
+    int16_t outR[MaxFrames];
+    int16_t out[MaxFrames * 2];
+
+    const auto peak = convert::toInt16(inL, inR, outL, outR, numFrames);
+
+    check(memcmp(outL, refL, numFrames * sizeof(int16_t)) == 0, numFrames, "left samples differ");
+    check(memcmp(outR, refR, numFrames * sizeof(int16_t)) == 0, numFrames, "right samples differ");
+    check(peak.left == refPeakL && peak.right == refPeakR, numFrames, "peaks differ");
+
+    for (size_t i = 0; i < numFrames; ++i)
+        check(convert::toInt16(inL[i]) == refL[i], numFrames, "scalar conversion differs");
+
+    const auto peakInterleaved = convert::toInt16Interleaved(inL, inR, out, numFrames);
+
+    check(memcmp(out, refFrames, numFrames * sizeof(uint32_t)) == 0, numFrames, "interleaved frames differ");
+    check(peakInterleaved.left == refPeakL && peakInterleaved.right == refPeakR, numFrames,
+          "interleaved peaks differ");
+
+    convert::interleave(refL, refR, out, numFrames);
+    check(memcmp(out, refFrames, numFrames * sizeof(uint32_t)) == 0, numFrames, "interleave differs");
+
+    // Dithered, frame i takes the noise of the generator lane i % 4
+    convert::Dither dither;
+    convert::Dither refDither = dither;
+    int16_t refDithered[MaxFrames * 2];
+
+    for (size_t i = 0; i < numFrames; ++i) {
+        const size_t lane = i % simd::LANES;
+        const float noiseL = convert::Dither::tpdf(convert::Dither::next(refDither.left[lane]));
+        const float noiseR = convert::Dither::tpdf(convert::Dither::next(refDither.right[lane]));
+
+        refDithered[2 * i] = convert::toInt16(inL[i], noiseL);
+        refDithered[2 * i + 1] = convert::toInt16(inR[i], noiseR);
+    }
+
+    const auto peakDithered = convert::toInt16Dithered(inL, inR, out, numFrames, dither);
+
+    check(memcmp(out, refDithered, numFrames * 2 * sizeof(int16_t)) == 0, numFrames, "dithered frames differ");
+    check(memcmp(&dither, &refDither, sizeof(dither)) == 0, numFrames, "dither state differs");
+    check(peakDithered.left == refPeakL && peakDithered.right == refPeakR, numFrames, "dithered peaks differ");
+
+    dither = convert::Dither();
+    convert::toInt16Dithered(inL, inR, outL, outR, numFrames, dither);
+
+    bool planar = true;
+
+    for (size_t i = 0; i < numFrames; ++i)
+        planar = planar && outL[i] == refDithered[2 * i] && outR[i] == refDithered[2 * i + 1];
+
+    check(planar, numFrames, "planar dithered samples differ");
+
+    // 24-bit
+    int32_t out24[MaxFrames * 2];
+    const auto peak24 = convert::toInt24Interleaved(inL, inR, out24, numFrames);
+
+    bool same24 = true;
+
+    for (size_t i = 0; i < numFrames; ++i) {
+        same24 = same24 && out24[2 * i] == convert::toInt24(inL[i]) && out24[2 * i + 1] == convert::toInt24(inR[i]);
+        same24 = same24 && (out24[2 * i] & 0xff) == 0 && (out24[2 * i + 1] & 0xff) == 0;
+    }
+
+    check(same24, numFrames, "24-bit frames differ");
+    check(peak24.left == refPeakL && peak24.right == refPeakR, numFrames, "24-bit peaks differ");
+}
+
+// Rounding with TPDF noise: error mean 0 and variance 1/6 + 1/12 LSB^2,
+// independent of the signal level, and within 1.5 LSB.
+static void testDitherStatistics()
+{
+    constexpr size_t numBlocks = 4000;
+
+    convert::Dither dither;
+    int16_t out[MaxFrames * 2];
+
+    for (float level : { 0.0f, 0.3f / 32767.0f, 0.5f / 32767.0f, 0.25f }) {
+        double sum = 0.0;
+        double sumSquares = 0.0;
+        double maxError = 0.0;
+
+        for (size_t i = 0; i < MaxFrames; ++i) {
+            inL[i] = level;
+            inR[i] = -level;
+        }
+
+        for (size_t block = 0; block < numBlocks; ++block) {
+            convert::toInt16Dithered(inL, inR, out, MaxFrames, dither);
+
+            for (size_t i = 0; i < MaxFrames * 2; ++i) {
+                const double e = double(out[i]) - double(i & 1 ? inR[0] : inL[0]) * 32767.0;
+                sum += e;
+                sumSquares += e * e;
+                maxError = std::max(maxError, fabs(e));
+            }
+        }
+
+        const double n = double(numBlocks * MaxFrames * 2);
+        const double mean = sum / n;
+        const double variance = sumSquares / n - mean * mean;
+
+        printf("dither at %.6f: error mean %.5f, variance %.4f, max %.3f LSB\n", level, mean, variance, maxError);
+
+        check(fabs(mean) < 0.01, MaxFrames, "dither error is biased");
+        check(variance > 0.24 && variance < 0.26, MaxFrames, "dither error variance is not TPDF");
+        check(maxError <= 1.5, MaxFrames, "dither error above 1.5 LSB");
+    }
+}
+
+int main()
+{
+    for (uint32_t seed = 1; seed <= 100; ++seed) {
+        prepareInput(seed);
+
+        // Whole vectors and the scalar tail
+        for (size_t numFrames : { size_t(128), size_t(256), size_t(61), size_t(3), size_t(0) })
+            test(numFrames);
+    }
+
+    testDitherStatistics();
+
+    if (failures > 0)
+        return 1;
+
+    puts("OK");
+    return 0;
+}
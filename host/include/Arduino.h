@@ -0,0 +1,33 @@
+#pragma once
+
+/*
+ * Minimal Arduino.h replacement for the host (Linux) build.
+ *
+ * Only provides what the engine code uses, so that src/engine can be
+ * compiled natively without the Teensyduino core.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#ifndef F_CPU
+#define F_CPU 600000000
+#endif
+
+// Memory placement attributes are meaningless on the host.
+#define DMAMEM
+#define FASTRUN
+#define PROGMEM
+
+// There is no audio interrupt on the host, the engine is driven
+// synchronously by the caller.
+#define IRQ_SOFTWARE 0
+#define IRQ_Reserved2 1
+#define NVIC_ENABLE_IRQ(n)  ((void)(n))
+#define NVIC_DISABLE_IRQ(n) ((void)(n))
+
+uint32_t micros();
+uint32_t millis();
@@ -0,0 +1,27 @@
+#pragma once
+
+/*
+ * Minimal AudioStream.h replacement for the host (Linux) build.
+ *
+ * Mirrors the block size and sample rate definitions of the
+ * Teensy audio library.
+ */
+
+#include <stdint.h>
+
+#ifndef AUDIO_BLOCK_SAMPLES
+#define AUDIO_BLOCK_SAMPLES  128
+#endif
+
+#ifndef AUDIO_SAMPLE_RATE_EXACT
+#define AUDIO_SAMPLE_RATE_EXACT 44100.0f
+#endif
+
+#define AUDIO_SAMPLE_RATE AUDIO_SAMPLE_RATE_EXACT
+
+typedef struct audio_block_struct {
+	uint8_t  ref_count;
+	uint8_t  reserved1;
+	uint16_t memory_pool_index;
+	int16_t  data[AUDIO_BLOCK_SAMPLES];
+} audio_block_t;
@@ -0,0 +1,195 @@
+/*
+ * MidiQueue stress test: one thread pushes messages as fast as it can
+ * while another one drains the queue with random pauses, so that the
+ * queue overflows all the time. Checks every overflow policy for lost
+ * ordering, duplicates and the overflow counter.
+ *
+ * Returns non-zero on failure.
+ */
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include "engine/MidiMessage.h"
+
+using Queue = MidiQueue<64>;
+
+constexpr uint32_t NumMessages = 300000;
+constexpr int NumControllers = 100;
+constexpr int NumControllerValues = 128;
+
+static int failures = 0;
+
+static void check(bool condition, const char* policy, const char* what)
+{
+    if (! condition) {
+        printf("FAILED %s: %s\n", policy, what);
+        failures += 1;
+    }
+}
+
+// Random short delays and thread switches, so that either side gets
+// ahead of the other one and is interrupted in the middle of push/pop.
+static void pause(uint32_t& seed)
+{
+    seed = seed * 1664525u + 1013904223u;
+
+    if ((seed >> 24) < 4) {
+        volatile uint32_t n = seed >> 22;
+        while (n > 0)
+            n = n - 1;
+    } else if ((seed >> 24) < 6) {
+        std::this_thread::yield();
+    }
+}
+
+// Messages are plain sequence numbers.
+static void testSequence(MidiOverflow policy, const char* name)
+{
+    Queue queue;
+    queue.setOverflowPolicy(policy);
+
+    std::atomic<bool> done(false);
+
+    std::thread producer([&]() {
+        uint32_t seed = 2;
+
+        for (uint32_t i = 1; i <= NumMessages; ++i) {
+            queue.push(MidiMessage(i));
+            pause(seed);
+        }
+
+        done = true;
+    });
+
+    uint32_t received = 0;
+    uint32_t last = 0;
+    bool ordered = true;
+    uint32_t seed = 1;
+
+    MidiMessage msg;
+
+    for (;;) {
+        const bool finished = done;
+
+        while (queue.pop(msg)) {
+            ordered = ordered && (msg.rawData > last);
+            last = msg.rawData;
+            received += 1;
+            pause(seed);
+        }
+
+        if (finished)
+            break;
+    }
+
+    producer.join();
+
+    printf("%s: received %u, overflows %u\n", name, received, queue.numOverflows());
+
+    check(ordered, name, "messages out of order or duplicated");
+    check(queue.numOverflows() > 0, name, "queue never overflowed");
+    check(received + queue.numOverflows() == NumMessages, name, "lost messages not accounted for");
+
+    if (policy == MidiOverflow::DropOldest)
+        check(last == NumMessages, name, "newest message dropped");
+}
+
+// Notes carry a sequence number in the note, velocity and the unused
+// top byte, each controller is swept from 0 to 127 in between.
+static void testCoalesce()
+{
+    const char* name = "Coalesce";
+
+    Queue queue;
+    queue.setOverflowPolicy(MidiOverflow::Coalesce);
+
+    std::atomic<bool> done(false);
+
+    std::thread producer([&]() {
+        int cc = 0;
+        int value = 0;
+        uint32_t seed = 2;
+
+        for (uint32_t i = 1; i <= NumMessages; ++i) {
+            const auto note = MidiMessage::noteOn((i >> 7) & 0x7F, i & 0x7F);
+            queue.push(MidiMessage(note.rawData | ((i >> 14) << 24)));
+
+            if (value < NumControllerValues && (i % 8) == 0) {
+                queue.push(MidiMessage::controlChange(cc, value));
+
+                if (++cc == NumControllers) {
+                    cc = 0;
+                    value += 1;
+                }
+            }
+
+            pause(seed);
+        }
+
+        done = true;
+    });
+
+    std::vector<int> lastValue(NumControllers, -1);
+    uint32_t notes = 0;
+    uint32_t controllers = 0;
+    uint32_t lastNote = 0;
+    bool ordered = true;
+    bool monotonic = true;
+    uint32_t seed = 1;
+
+    MidiMessage msg;
+
+    for (;;) {
+        const bool finished = done;
+
+        while (queue.pop(msg)) {
+            if (msg.type() == MidiMessage::Type::ControlChange) {
+                // Values of a controller never go back in time.
+                auto& v = lastValue[msg.cc()];
+                monotonic = monotonic && (msg.value() >= v);
+                v = msg.value();
+                controllers += 1;
+            } else {
+                const uint32_t n = ((msg.rawData >> 24) << 14) | uint32_t((msg.note() << 7) | msg.velocity());
+                ordered = ordered && (n > lastNote);
+                lastNote = n;
+                notes += 1;
+            }
+
+            pause(seed);
+        }
+
+        if (finished)
+            break;
+    }
+
+    producer.join();
+
+    printf("%s: received %u notes, %u controllers, overflows %u\n", name, notes, controllers, queue.numOverflows());
+
+    bool latest = true;
+
+    for (int v : lastValue)
+        latest = latest && (v == NumControllerValues - 1);
+
+    check(ordered, name, "notes out of order or duplicated");
+    check(monotonic, name, "controller values out of order");
+    check(latest, name, "latest controller values lost");
+    check(queue.numOverflows() > 0, name, "queue never overflowed");
+}
+
+int main()
+{
+    testSequence(MidiOverflow::DropNewest, "DropNewest");
+    testSequence(MidiOverflow::DropOldest, "DropOldest");
+    testCoalesce();
+
+    if (failures > 0)
+        return 1;
+
+    puts("OK");
+    return 0;
+}
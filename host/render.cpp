@@ -0,0 +1,181 @@
+/*
+ * Offline renderer: plays a Standard MIDI File through the engine
+ * and writes the result to a stereo WAV file.
+ *
+ * Reports the rendering speed as a multiple of real time, so that
+ * Engine::process performance can be tracked on a host machine.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include "engine/Globals.h"
+#include "engine/Engine.h"
+#include "engine/CycleCounter.h"
+#include "engine/Profiler.h"
+#include "engine/Convert.h"
+#include "engine/Arena.h"
+#include "MidiFile.h"
+#include "WavWriter.h"
+
+using Clock = std::chrono::steady_clock;
+
+constexpr double DefaultTailTime = 3.0; // [s]
+
+static void usage(const char* name)
+{
+    fprintf(stderr, "Usage: %s [-t tail_seconds] [-b engine_block_size] [-d] input.mid output.wav\n", name);
+    fprintf(stderr, "  -d  TPDF dither the 16-bit output\n");
+}
+
+// Time stamps are in samples, see the blocks time below.
+static void dispatch(Engine& engine, const MidiFile::Event& e)
+{
+    const int channel = (e.status & 0x0F) + 1;
+    const uint32_t timestamp = (uint32_t) (e.time * globals::SAMPLE_RATE);
+
+    switch (e.status & 0xF0)
+    {
+        case 0x80: engine.noteOff(channel, e.data1, e.data2, timestamp); break;
+        case 0x90: engine.noteOn(channel, e.data1, e.data2, timestamp); break;
+        case 0xB0: engine.controlChange(channel, e.data1, e.data2, timestamp); break;
+        default: break;
+    }
+}
+
+// Engine is too large to be kept on the stack.
+static Engine engine;
+
+int main(int argc, char** argv)
+{
+    double tailTime = DefaultTailTime;
+    bool dither = false;
+    int arg = 1;
+
+    while (arg + 1 < argc && argv[arg][0] == '-') {
+        if (::strcmp(argv[arg], "-d") == 0) {
+            dither = true;
+            arg += 1;
+            continue;
+        }
+
+        if (::strcmp(argv[arg], "-t") == 0) {
+            tailTime = atof(argv[arg + 1]);
+        } else if (::strcmp(argv[arg], "-b") == 0) {
+            engine.setBlockSize((size_t) atoi(argv[arg + 1]));
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+
+        arg += 2;
+    }
+
+    if (argc - arg != 2) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    const char* inputPath = argv[arg];
+    const char* outputPath = argv[arg + 1];
+
+    MidiFile midi;
+
+    if (! midi.load(inputPath)) {
+        fprintf(stderr, "%s: %s\n", inputPath, midi.error().c_str());
+        return 1;
+    }
+
+    WavWriter wav;
+
+    if (! wav.open(outputPath, (uint32_t) globals::SAMPLE_RATE)) {
+        fprintf(stderr, "Unable to create %s\n", outputPath);
+        return 1;
+    }
+
+    constexpr size_t blockSize = globals::AUDIO_BLOCK_SIZE;
+
+    const auto& events = midi.events();
+    const double duration = midi.duration() + tailTime;
+    const size_t numBlocks = (size_t) ceil(duration * globals::SAMPLE_RATE / blockSize);
+
+    alignas(16) float outL[blockSize];
+    alignas(16) float outR[blockSize];
+    int16_t interleaved[blockSize * 2];
+    convert::Dither ditherState;
+
+    size_t nextEvent = 0;
+    Clock::duration processTime {};
+    Clock::duration maxBlockTime {};
+    size_t sleepingBlocks = 0;
+
+    const auto renderBegin = Clock::now();
+
+    for (size_t block = 0; block < numBlocks; ++block) {
+        // Events of this block period are applied with one block
+        // latency at their exact frame, same as on the device.
+        const double blockEnd = double((block + 1) * blockSize) / globals::SAMPLE_RATE;
+
+        while (nextEvent < events.size() && events[nextEvent].time < blockEnd)
+            dispatch(engine, events[nextEvent++]);
+
+#if defined(ENGINE_PROFILING)
+        const auto blockBegin = perf::CycleCounter::now();
+#endif
+        const auto processBegin = Clock::now();
+        engine.process(outL, outR, blockSize, (uint32_t) ((block + 1) * blockSize));
+        const auto blockTime = Clock::now() - processBegin;
+
+        processTime += blockTime;
+        maxBlockTime = std::max(maxBlockTime, blockTime);
+
+        if (engine.sleepingEffects() != 0)
+            ++sleepingBlocks;
+
+        {
+            PROFILE_SCOPE(perf::Profiler::Convert);
+
+            if (dither)
+                convert::toInt16Dithered(outL, outR, interleaved, blockSize, ditherState);
+            else
+                convert::toInt16Interleaved(outL, outR, interleaved, blockSize);
+        }
+
+#if defined(ENGINE_PROFILING)
+        PROFILE_BLOCK(perf::CycleCounter::since(blockBegin));
+#endif
+
+        wav.write(interleaved, blockSize);
+    }
+
+    const auto renderTime = Clock::now() - renderBegin;
+    wav.close();
+
+    using Seconds = std::chrono::duration<double>;
+    using Microseconds = std::chrono::duration<double, std::micro>;
+
+    const double audioSeconds = double(numBlocks * blockSize) / globals::SAMPLE_RATE;
+    const double renderSeconds = Seconds(renderTime).count();
+    const double processSeconds = Seconds(processTime).count();
+
+    printf("Engine block size: %u samples\n", (unsigned) engine.blockSize());
+    printf("Rendered %.2f s of audio in %.3f s (%.1fx real time)\n",
+           audioSeconds, renderSeconds, audioSeconds / renderSeconds);
+    printf("Engine::process: %.1fx real time, avg %.2f us/block, max %.2f us/block (budget %.2f us)\n",
+           audioSeconds / processSeconds,
+           Microseconds(processTime).count() / numBlocks,
+           Microseconds(maxBlockTime).count(),
+           globals::AUDIO_BLOCK_US);
+    printf("Skipped operator blocks: %u\n", (unsigned) engine.numSkippedOperatorBlocks());
+    printf("MIDI overflows: %u\n", (unsigned) engine.numMidiOverflows());
+    printf("Blocks with sleeping effects: %u of %u\n", (unsigned) sleepingBlocks, (unsigned) numBlocks);
+    mem::report([](const char* line) { puts(line); });
+
+#if defined(ENGINE_PROFILING)
+    perf::Profiler::instance().report([](const char* line) { puts(line); });
+#endif
+
+    return 0;
+}
@@ -0,0 +1,53 @@
+#include <cstdio>
+#include "engine/Globals.h"
+#include "engine/Arena.h"
+
+namespace {
+
+// Plain globals are placed in DTCM on Teensy.
+__attribute__((aligned(16))) uint8_t fastMemory[ENGINE_ARENA_FAST_SIZE];
+DMAMEM __attribute__((aligned(32))) uint8_t bulkMemory[ENGINE_ARENA_BULK_SIZE];
+
+// Constant initialized, usable from the global objects constructors.
+mem::Arena arenas[] = {
+    { fastMemory, sizeof(fastMemory), "fast (DTCM)" },
+    { bulkMemory, sizeof(bulkMemory), "bulk (OCRAM)" }
+};
+
+static_assert(sizeof(arenas) / sizeof(arenas[0]) == size_t(mem::Region::NumRegions), "Arena per region expected");
+
+} // anonymous namespace
+
+namespace mem {
+
+void* Arena::allocate(size_t size, size_t alignment)
+{
+    const uintptr_t base = reinterpret_cast<uintptr_t>(m_base);
+    const uintptr_t offset = ((base + m_used + alignment - 1) & ~uintptr_t(alignment - 1)) - base;
+
+    if (offset + size > m_capacity) {
+        m_numFailed += 1;
+        return nullptr;
+    }
+
+    m_used = offset + size;
+    return m_base + offset;
+}
+
+Arena& arena(Region region)
+{
+    return arenas[size_t(region)];
+}
+
+void report(PrintFunc print)
+{
+    char line[96];
+
+    for (const auto& a : arenas) {
+        snprintf(line, sizeof(line), "Memory %-13s %7u of %7u bytes used, %u failed allocations",
+                 a.name(), (unsigned) a.used(), (unsigned) a.capacity(), (unsigned) a.numFailed());
+        print(line);
+    }
+}
+
+} // namespace mem
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+/**
+ * Static memory for the engine state.
+ *
+ * The engine objects take their buffers from fixed size regions when
+ * they are constructed, nothing is ever freed and the heap is not used.
+ * Small and hot state goes to the fast region (DTCM on Teensy), bulk
+ * buffers like the delay lines to the bulk region (OCRAM, DMAMEM).
+ */
+
+// Fast region size in bytes
+#ifndef ENGINE_ARENA_FAST_SIZE
+#   define ENGINE_ARENA_FAST_SIZE (4 * 1024)
+#endif
+
+// Bulk region size in bytes. The FDN reverb takes 61 KB, the benchmark
+// builds its own reverbs and delay lines next to the ones of the engine.
+#ifndef ENGINE_ARENA_BULK_SIZE
+#   if defined(ENGINE_FDN_REVERB) && defined(ENGINE_BENCHMARK)
+#       define ENGINE_ARENA_BULK_SIZE (176 * 1024)
+#   elif defined(ENGINE_FDN_REVERB) || defined(ENGINE_BENCHMARK)
+#       define ENGINE_ARENA_BULK_SIZE (128 * 1024)
+#   else
+#       define ENGINE_ARENA_BULK_SIZE (64 * 1024)
+#   endif
+#endif
+
+namespace mem {
+
+enum class Region
+{
+    Fast,   // DTCM
+    Bulk,   // OCRAM
+
+    NumRegions
+};
+
+/**
+ * @brief Bump allocator over a static buffer.
+ */
+class Arena final
+{
+public:
+
+    constexpr Arena(uint8_t* base, size_t capacity, const char* name)
+        : m_base(base)
+        , m_capacity(capacity)
+        , m_used(0)
+        , m_numFailed(0)
+        , m_name(name)
+    {
+    }
+
+    /// Uninitialized memory, nullptr if the arena is exhausted.
+    void* allocate(size_t size, size_t alignment);
+
+    size_t used() const noexcept { return m_used; }
+    size_t capacity() const noexcept { return m_capacity; }
+    const char* name() const noexcept { return m_name; }
+
+    /// Allocations that did not fit.
+    uint32_t numFailed() const noexcept { return m_numFailed; }
+
+private:
+    uint8_t* m_base;
+    size_t m_capacity;
+    size_t m_used;
+    uint32_t m_numFailed;
+    const char* m_name;
+};
+
+Arena& arena(Region region);
+
+/// Array of default constructed objects, nullptr if the region is exhausted.
+template <typename T>
+T* allocate(Region region, size_t count)
+{
+    void* p = arena(region).allocate(sizeof(T) * count, alignof(T));
+
+    if (p == nullptr)
+        return nullptr;
+
+    T* objects = static_cast<T*>(p);
+
+    for (size_t i = 0; i < count; ++i)
+        new (objects + i) T();
+
+    return objects;
+}
+
+/// Receives one line of the report at a time (without line ending).
+using PrintFunc = void (*)(const char* line);
+
+/// Bytes used in every region.
+void report(PrintFunc print);
+
+} // namespace mem
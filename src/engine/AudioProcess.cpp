@@ -2,23 +2,43 @@
 #include <cmath>
 #include "engine/Globals.h"
 #include "engine/AudioProcess.h"
+#include "engine/CycleCounter.h"
+#include "engine/Profiler.h"
+
+#if defined(AUDIO_OUTPUT_DIRECT)
+#   include "output_i2s.h"
+#endif
+
+// Lower priority than the audio interrupt (208), see AudioStream.cpp
+constexpr uint8_t RENDER_AHEAD_IRQ_PRIORITY = 240;
+
+static AudioProcess* renderAheadInstance = nullptr;
 
 AudioProcess::AudioProcess()
     : AudioStream(0, nullptr)
     , m_audioEngine()
+#if !defined(AUDIO_OUTPUT_DIRECT)
     , m_audioData { nullptr, nullptr }
+#endif
+    , m_renderAheadEnabled(false)
+    , m_renderAheadTime(0)
+    , m_ditherEnabled(false)
     , m_dspLoadPercent(0.0f)
 {
     globalInitialize();
 
+#if !defined(AUDIO_OUTPUT_DIRECT)
     m_audioData[0] = allocate();
     m_audioData[1] = allocate();
+#endif
 }
 
 AudioProcess::~AudioProcess()
 {
+#if !defined(AUDIO_OUTPUT_DIRECT)
     release(m_audioData[0]);
     release(m_audioData[1]);
+#endif
 }
 
 int AudioProcess::numActiveVoices() const noexcept
@@ -26,43 +46,205 @@ int AudioProcess::numActiveVoices() const noexcept
     return m_audioEngine.numActiveVoices();
 }
 
-void AudioProcess::update()
+uint32_t AudioProcess::numSkippedOperatorBlocks() const noexcept
 {
-    const auto beginUpdate_us = micros();
+    return m_audioEngine.numSkippedOperatorBlocks();
+}
 
-    float* outL = m_audioBuffer;
-    float* outR = &m_audioBuffer[globals::AUDIO_BLOCK_SIZE];
+uint32_t AudioProcess::numMidiOverflows() const noexcept
+{
+    return m_audioEngine.numMidiOverflows();
+}
+
+uint32_t AudioProcess::sleepingEffects() const noexcept
+{
+    return m_audioEngine.sleepingEffects();
+}
 
-    m_audioEngine.process(outL, outR, globals::AUDIO_BLOCK_SIZE);
+#if defined(AUDIO_OUTPUT_DIRECT)
 
-    float maxL = 0.0f;
-    float maxR = 0.0f;
+// The block goes straight into the I2S DMA buffer half that has just
+// been played, nothing is transmitted, see AudioOutputI2S::isr_direct().
+void AudioProcess::update()
+{
+    auto* out = static_cast<OutputSample*>(AudioOutputI2S::directBuffer());
 
-    // Convert to 16-bit integer
-    for (size_t i = 0; i < globals::AUDIO_BLOCK_SIZE; ++i) {
-        const float l = math::clamp(-1.0f, 1.0f, outL[i]);
-        const float r = math::clamp(-1.0f, 1.0f, outR[i]);
+    if (out == nullptr)
+        return;
 
-        maxL = std::max(maxL, fabsf(l));
-        maxR = std::max(maxR, fabsf(r));
+    if (m_renderAheadEnabled) {
+        if (const auto* block = m_renderAhead.nextToPlay()) {
+            ::memcpy(out, block->frames, sizeof(block->frames));
+            m_renderAhead.played();
+        } else {
+            ::memset(out, 0, sizeof(OutputBlock::frames));
+        }
 
-        m_audioData[0]->data[i] = (int16_t) (l * 32767.0f);
-        m_audioData[1]->data[i] = (int16_t) (r * 32767.0f);
+        // Refill the ring once this interrupt returns.
+        NVIC_SET_PENDING(Engine::AudioLock::RENDER_AHEAD_IRQ);
+    } else {
+        renderFrames(out, Engine::timestamp());
     }
 
-    m_amplitudeL = maxL;
-    m_amplitudeR = maxR;
+    // The DMA reads from the memory, not the cache.
+    arm_dcache_flush_delete(out, sizeof(OutputBlock::frames));
+}
+
+#else
+
+void AudioProcess::update()
+{
+    if (m_renderAheadEnabled) {
+        if (const auto* block = m_renderAhead.nextToPlay()) {
+            ::memcpy(m_audioData[0]->data, block->left, sizeof(block->left));
+            ::memcpy(m_audioData[1]->data, block->right, sizeof(block->right));
+            m_renderAhead.played();
+        } else {
+            ::memset(m_audioData[0]->data, 0, sizeof(m_audioData[0]->data));
+            ::memset(m_audioData[1]->data, 0, sizeof(m_audioData[1]->data));
+        }
+
+        // Refill the ring once this interrupt returns.
+        NVIC_SET_PENDING(Engine::AudioLock::RENDER_AHEAD_IRQ);
+    } else {
+        renderBlock(m_audioData[0]->data, m_audioData[1]->data, Engine::timestamp());
+    }
 
     transmit(m_audioData[0], 0);
     transmit(m_audioData[1], 1);
+}
+
+#endif // AUDIO_OUTPUT_DIRECT
+
+void AudioProcess::setRenderAhead(size_t numBlocks)
+{
+    Engine::AudioLock lock;
+
+    if (renderAheadInstance == nullptr) {
+        renderAheadInstance = this;
+        attachInterruptVector(IRQ_NUMBER_t(Engine::AudioLock::RENDER_AHEAD_IRQ), renderAheadIsr);
+        NVIC_SET_PRIORITY(Engine::AudioLock::RENDER_AHEAD_IRQ, RENDER_AHEAD_IRQ_PRIORITY);
+        NVIC_ENABLE_IRQ(Engine::AudioLock::RENDER_AHEAD_IRQ);
+    }
+
+    m_renderAheadEnabled = numBlocks > 0;
+
+    if (m_renderAheadEnabled) {
+        m_renderAhead.setLatency(numBlocks);
+
+        // Fill the ring before the next update().
+        NVIC_SET_PENDING(Engine::AudioLock::RENDER_AHEAD_IRQ);
+    }
+}
+
+void AudioProcess::renderAheadIsr()
+{
+    renderAheadInstance->renderAheadBlocks();
+}
+
+void AudioProcess::renderAheadBlocks()
+{
+    if (! m_renderAheadEnabled)
+        return;
 
-    const auto endUpdate_us = micros();
-    const float load = 100.0f * (endUpdate_us - beginUpdate_us) * globals::AUDIO_BLOCK_US_R;
+    // Blocks rendered back to back each take the next block period of
+    // MIDI messages, never past the time they are rendered at. A clock
+    // fallen behind by more than the ring (render ahead just enabled)
+    // starts over from now.
+    const uint32_t now = Engine::timestamp();
+    const uint32_t period = uint32_t(globals::AUDIO_BLOCK_US * 1e-6f * perf::CycleCounter::ticksPerSecond());
+    const uint32_t maxLag = period * uint32_t(m_renderAhead.latency());
+
+    while (auto* block = m_renderAhead.nextToRender()) {
+        uint32_t blockTime = m_renderAheadTime + period;
+
+        if (int32_t(now - blockTime) < 0 || now - blockTime > maxLag)
+            blockTime = now;
+
+        m_renderAheadTime = blockTime;
+
+#if defined(AUDIO_OUTPUT_DIRECT)
+        renderFrames(block->frames, blockTime);
+#else
+        renderBlock(block->left, block->right, blockTime);
+#endif
+        m_renderAhead.rendered();
+    }
+}
+
+void AudioProcess::renderBlock(int16_t* dataL, int16_t* dataR, uint32_t blockTime)
+{
+    const auto beginRender = renderEngine(blockTime);
+    convert::Peak peak;
+
+    {
+        PROFILE_SCOPE(perf::Profiler::Convert);
+
+        const float* outL = m_audioBuffer;
+        const float* outR = &m_audioBuffer[globals::AUDIO_BLOCK_SIZE];
+
+        if (m_ditherEnabled)
+            peak = convert::toInt16Dithered(outL, outR, dataL, dataR, globals::AUDIO_BLOCK_SIZE, m_dither);
+        else
+            peak = convert::toInt16(outL, outR, dataL, dataR, globals::AUDIO_BLOCK_SIZE);
+    }
+
+    updateLoad(beginRender, peak);
+}
+
+#if defined(AUDIO_OUTPUT_DIRECT)
+
+void AudioProcess::renderFrames(OutputSample* out, uint32_t blockTime)
+{
+    const auto beginRender = renderEngine(blockTime);
+    convert::Peak peak;
+
+    {
+        PROFILE_SCOPE(perf::Profiler::Convert);
+
+        const float* outL = m_audioBuffer;
+        const float* outR = &m_audioBuffer[globals::AUDIO_BLOCK_SIZE];
+
+#if defined(AUDIO_OUTPUT_24BIT)
+        peak = convert::toInt24Interleaved(outL, outR, out, globals::AUDIO_BLOCK_SIZE);
+#else
+        if (m_ditherEnabled)
+            peak = convert::toInt16Dithered(outL, outR, out, globals::AUDIO_BLOCK_SIZE, m_dither);
+        else
+            peak = convert::toInt16Interleaved(outL, outR, out, globals::AUDIO_BLOCK_SIZE);
+#endif
+    }
+
+    updateLoad(beginRender, peak);
+}
+
+#endif // AUDIO_OUTPUT_DIRECT
+
+perf::CycleCounter::Ticks AudioProcess::renderEngine(uint32_t blockTime)
+{
+    const auto beginRender = perf::CycleCounter::now();
+
+    m_audioEngine.process(m_audioBuffer, &m_audioBuffer[globals::AUDIO_BLOCK_SIZE], globals::AUDIO_BLOCK_SIZE, blockTime);
+
+    return beginRender;
+}
+
+void AudioProcess::updateLoad(perf::CycleCounter::Ticks beginRender, const convert::Peak& peak)
+{
+    m_amplitudeL = peak.left;
+    m_amplitudeR = peak.right;
+
+    const auto renderTicks = perf::CycleCounter::since(beginRender);
+    PROFILE_BLOCK(renderTicks);
+
+    const float load = 100.0f * perf::CycleCounter::toMicroseconds(renderTicks) * globals::AUDIO_BLOCK_US_R;
 
     if (load > m_dspLoadPercent)
         m_dspLoadPercent = load;
     else
         m_dspLoadPercent = 0.9f * m_dspLoadPercent + 0.1f * load;
+
+    m_audioEngine.updateQuality(m_dspLoadPercent);
 }
 
 void AudioProcess::noteOn(int channel, int note, int velocity)
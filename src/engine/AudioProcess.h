@@ -3,20 +3,71 @@
 #include <AudioStream.h>
 #include "engine/Globals.h"
 #include "engine/Engine.h"
+#include "engine/RenderAhead.h"
+#include "engine/Convert.h"
+
+// Most blocks that can be rendered ahead, see AudioProcess::setRenderAhead()
+#ifndef AUDIO_RENDER_AHEAD_MAX_BLOCKS
+#   define AUDIO_RENDER_AHEAD_MAX_BLOCKS 8
+#endif
 
 class AudioProcess : public AudioStream
 {
 public:
+
+#if defined(AUDIO_OUTPUT_24BIT)
+    using OutputSample = int32_t;
+#else
+    using OutputSample = int16_t;
+#endif
+
     AudioProcess();
     ~AudioProcess();
 
     float dspLoadPercent() const noexcept { return m_dspLoadPercent; }
     int numActiveVoices() const noexcept;
+    uint32_t numSkippedOperatorBlocks() const noexcept;
+    uint32_t numMidiOverflows() const noexcept;
+    uint32_t sleepingEffects() const noexcept;
     float amplitudeL() const noexcept { return m_amplitudeL; }
     float amplitudeR() const noexcept { return m_amplitudeR; }
 
+    /// Quality reduced due to the DSP load, 0 for the full quality.
+    int qualityLevel() const noexcept { return m_audioEngine.qualityLevel(); }
+
     void update() override;
 
+    /**
+     * @brief Render blocks ahead of the audio interrupt.
+     *
+     * With a non-zero number of blocks the engine renders into a ring of
+     * blocks from a lower priority interrupt and update() only plays the
+     * oldest one. This adds numBlocks of latency but absorbs the blocks
+     * that take longer than the block period to render. Zero renders
+     * every block within update().
+     */
+    void setRenderAhead(size_t numBlocks);
+    size_t renderAhead() const noexcept { return m_renderAheadEnabled ? m_renderAhead.latency() : 0; }
+
+    /// Fewest blocks left in the ring when update() took one, since the last reset.
+    size_t minRenderAheadBlocks() const noexcept { return m_renderAhead.minReadyBlocks(); }
+
+    /// Blocks played as silence because the ring has run dry.
+    uint32_t numRenderAheadUnderruns() const noexcept { return m_renderAhead.numUnderruns(); }
+
+    void resetRenderAheadStats() { m_renderAhead.resetStats(); }
+
+    /**
+     * @brief Enable the TPDF dither of the 16-bit output.
+     *
+     * Dithered samples are rounded to the nearest instead of being
+     * truncated, see convert::toInt16Dithered(). The 24-bit output
+     * is not dithered. Off by default until the dithered conversion
+     * has been measured on the device (Benchmark, ENGINE_BENCHMARK).
+     */
+    void setDither(bool enabled) { m_ditherEnabled = enabled; }
+    bool dither() const noexcept { return m_ditherEnabled; }
+
     //
     void noteOn(int channel, int note, int velocity);
     void noteOff(int channel, int node, int velocity);
@@ -26,10 +77,48 @@ private:
 
     static void globalInitialize();
 
+    // Render-ahead interrupt handler
+    static void renderAheadIsr();
+
+    void renderAheadBlocks();
+
+    // Render a block into the 16-bit output buffers, MIDI messages up to blockTime
+    void renderBlock(int16_t* outL, int16_t* outR, uint32_t blockTime);
+
+#if defined(AUDIO_OUTPUT_DIRECT)
+    // Render a block into interleaved output frames
+    void renderFrames(OutputSample* out, uint32_t blockTime);
+#endif
+
+    // Render a block into the float buffer, returns the start time for updateLoad()
+    perf::CycleCounter::Ticks renderEngine(uint32_t blockTime);
+
+    void updateLoad(perf::CycleCounter::Ticks beginRender, const convert::Peak& peak);
+
     Engine m_audioEngine;
 
+#if !defined(AUDIO_OUTPUT_DIRECT)
     audio_block_t* m_audioData[2];
-    float m_audioBuffer[globals::AUDIO_BLOCK_SIZE * 2]; // Stereo audio buffer
+#endif
+    alignas(16) float m_audioBuffer[globals::AUDIO_BLOCK_SIZE * 2]; // Stereo audio buffer
+
+#if defined(AUDIO_OUTPUT_DIRECT)
+    // Blocks are rendered ahead in the I2S DMA buffer layout.
+    struct OutputBlock
+    {
+        OutputSample frames[globals::AUDIO_BLOCK_SIZE * 2];
+    };
+
+    RenderAhead<AUDIO_RENDER_AHEAD_MAX_BLOCKS, OutputBlock> m_renderAhead;
+#else
+    RenderAhead<AUDIO_RENDER_AHEAD_MAX_BLOCKS> m_renderAhead;
+#endif
+    volatile bool m_renderAheadEnabled;
+    uint32_t m_renderAheadTime; // Engine::timestamp() of the last block rendered ahead
+
+    convert::Dither m_dither;
+    bool m_ditherEnabled;
+
     float m_dspLoadPercent;
     float m_amplitudeL;
     float m_amplitudeR;
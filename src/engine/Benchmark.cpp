@@ -0,0 +1,797 @@
+#include "engine/Benchmark.h"
+
+// The kernels state is static, only built into the benchmark firmware.
+#if defined(ENGINE_BENCHMARK)
+
+#include <cstdio>
+#include <cmath>
+#include "engine/Globals.h"
+#include "engine/CycleCounter.h"
+#include "engine/DSP.h"
+#include "engine/Envelope.h"
+#include "engine/FmSynth.h"
+#include "engine/FmVoiceBank.h"
+#include "engine/Engine.h"
+#include "engine/Sine.h"
+#include "engine/FX_PitchShift.h"
+#include "engine/FX_Reverb.h"
+#include "engine/FX_FdnReverb.h"
+#include "engine/Convert.h"
+#include "engine/Arena.h"
+
+namespace bench {
+
+using perf::CycleCounter;
+
+constexpr size_t BlockSize = globals::AUDIO_BLOCK_SIZE;
+
+// Each kernel is measured this many times, the fastest run is reported.
+constexpr int NumRuns = 5;
+
+struct Kernel
+{
+    const char* name;
+    void (*prepare)();
+    void (*process)();
+
+    // False when the kernel did not get its memory from the arena, checked after prepare().
+    bool (*allocated)() = nullptr;
+};
+
+alignas(16) static float inL[BlockSize];
+alignas(16) static float inR[BlockSize];
+alignas(16) static float outL[BlockSize];
+alignas(16) static float outR[BlockSize];
+
+// Results are accumulated here so that the kernels cannot be optimized out.
+static volatile float sink;
+
+static void consume(const float* buffer)
+{
+    float s = 0.0f;
+
+    for (size_t i = 0; i < BlockSize; ++i)
+        s += buffer[i];
+
+    sink = sink + s;
+}
+
+//==============================================================================
+
+static float sinePhase;
+
+static void prepareSineLUT()
+{
+    sinePhase = 0.0f;
+}
+
+static void processSineLUT()
+{
+    constexpr float inc = 440.0f * globals::SAMPLE_RATE_R;
+    float p = sinePhase;
+
+    for (size_t i = 0; i < BlockSize; ++i) {
+        outL[i] = sineLUT(p);
+        p += inc;
+
+        if (p >= 1.0f)
+            p -= 1.0f;
+    }
+
+    sinePhase = p;
+    consume(outL);
+}
+
+// Sine kernels on a fixed point phase
+static uint32_t sineKernelPhase;
+constexpr uint32_t sineKernelInc = uint32_t(440.0 * 4294967296.0 / double(globals::SAMPLE_RATE));
+
+static float sinfKernel(uint32_t phase)
+{
+    return sinf(float(phase) * float(2.0 * M_PI / 4294967296.0));
+}
+
+static void prepareSineKernel()
+{
+    sineKernelPhase = 0;
+}
+
+template <float (*Kernel)(uint32_t)>
+static void processSineKernel()
+{
+    uint32_t p = sineKernelPhase;
+
+    for (size_t i = 0; i < BlockSize; ++i) {
+        outL[i] = Kernel(p);
+        p += sineKernelInc;
+    }
+
+    sineKernelPhase = p;
+    consume(outL);
+}
+
+struct SineVariant
+{
+    const char* name;
+    float (*kernel)(uint32_t);
+};
+
+static const SineVariant sineVariants[] = {
+    { "sine::table",         sine::table         },
+    { "sine::quarter",       sine::quarter       },
+    { "sine::quarterLinear", sine::quarterLinear },
+    { "sine::quarterCubic",  sine::quarterCubic  },
+    { "sine::polynomial",    sine::polynomial    },
+};
+
+static double toDecibels(double ratio)
+{
+    return 10.0 * log10(ratio > 1e-30 ? ratio : 1e-30);
+}
+
+/**
+ * @brief Prints SNR against sinf over the whole period,
+ *        THD (harmonics 2 to 9) and THD+N of a test tone.
+ */
+static void reportSineQuality(PrintFunc print)
+{
+    char line[128];
+
+    snprintf(line, sizeof(line), "%-32s %12s %14s %14s", "sine kernel", "SNR dB", "THD dB", "THD+N dB");
+    print(line);
+
+    // The test tone phase increment is not aligned to the
+    // table points, so that the kernels interpolate.
+    constexpr size_t numSamples = 1 << 16;
+    constexpr uint32_t cycles = 1001;
+    constexpr uint32_t toneInc = cycles << (32 - 16);
+
+    for (const auto& variant : sineVariants) {
+        // SNR
+        double signal = 0.0;
+        double noise = 0.0;
+        uint32_t x = 0x12345678;
+
+        for (size_t i = 0; i < numSamples; ++i) {
+            x = x * 1664525u + 1013904223u;
+            const uint32_t phase = uint32_t(i << (32 - 16)) + (x >> 16);
+            const double ref = sinf(float(double(phase) * (2.0 * M_PI / 4294967296.0)));
+            const double err = double(variant.kernel(phase)) - ref;
+            signal += ref * ref;
+            noise += err * err;
+        }
+
+        // Harmonics by correlation with the exact bins
+        double total = 0.0;
+        double harmonics = 0.0;
+        double fundamental = 0.0;
+
+        for (uint32_t h = 1; h <= 9; ++h) {
+            double re = 0.0;
+            double im = 0.0;
+
+            // Rotating phasor of the harmonic frequency
+            const double w = 2.0 * M_PI * double(h * cycles) / double(numSamples);
+            const double rotRe = cos(w);
+            const double rotIm = sin(w);
+            double zRe = 1.0;
+            double zIm = 0.0;
+
+            for (size_t i = 0; i < numSamples; ++i) {
+                const double v = variant.kernel(uint32_t(i) * toneInc);
+                re += v * zRe;
+                im += v * zIm;
+
+                const double t = zRe * rotRe - zIm * rotIm;
+                zIm = zRe * rotIm + zIm * rotRe;
+                zRe = t;
+
+                if (h == 1)
+                    total += v * v;
+            }
+
+            const double power = 2.0 * (re * re + im * im) / (double(numSamples) * double(numSamples));
+
+            if (h == 1)
+                fundamental = power;
+            else
+                harmonics += power;
+        }
+
+        total /= double(numSamples);
+
+        snprintf(line, sizeof(line), "%-32s %12.1f %14.1f %14.1f", variant.name,
+                 toDecibels(signal / noise),
+                 toDecibels(harmonics / fundamental),
+                 toDecibels((total - fundamental) / fundamental));
+        print(line);
+    }
+}
+
+//==============================================================================
+
+static FmVoice::FmOp fmOp;
+
+static void prepareFmOp()
+{
+    fmOp.phase = 0;
+    fmOp.setPhaseIncrement(440.0f * globals::SAMPLE_RATE_R);
+    fmOp.aeg.trigger({0.0f, 1000.0f, 0.0f, 1.0f});
+}
+
+static void processFmOp()
+{
+    for (size_t i = 0; i < BlockSize; ++i)
+        outL[i] = fmOp.tick(0.001f * inL[i]);
+
+    consume(outL);
+}
+
+//==============================================================================
+
+static ParameterPool* voiceParameters()
+{
+    static ParameterPool params(FmInstrument::NUM_PARAMS);
+    return &params;
+}
+
+static FmPatch voicePatch;
+static FmVoice voice;
+
+static void prepareFmVoice()
+{
+    auto& params = *voiceParameters();
+    params[FmInstrument::TONE].setValue(0.5f, true);
+    params[FmInstrument::MODULATION].setValue(0.5f, true);
+    params[FmInstrument::ALGORITHM].setRange(0.0f, float(fm::NUM_ALGORITHMS - 1));
+    params[FmInstrument::ALGORITHM].setValue(4.0f, true);
+
+    voice.setParametersPool(&params);
+    voice.setPatch(&voicePatch);
+    voice.trigger(60, 100);
+}
+
+static void processFmVoice()
+{
+    ::memset(outL, 0, sizeof(outL));
+    ::memset(outR, 0, sizeof(outR));
+    voice.process(outL, outR, BlockSize);
+    consume(outL);
+}
+
+// Skipped operators: without tone only the carriers are rendered,
+// with a muted modulator the other operators are rendered around it.
+static void prepareFmVoiceCarriers()
+{
+    prepareFmVoice();
+    (*voiceParameters())[FmInstrument::TONE].setValue(0.0f, true);
+}
+
+static void prepareFmVoiceMasked()
+{
+    static FmPatch patch;
+    patch.op[1].level = 0.0f;
+
+    prepareFmVoice();
+    voice.setPatch(&patch);
+    voice.trigger(60, 100);
+}
+
+//==============================================================================
+
+// Polyphonic load: the same 16 notes rendered per voice and by the voice bank.
+constexpr int NumPolyVoices = 16;
+
+static FmVoice polyVoices[NumPolyVoices];
+
+static void preparePolyFmVoices()
+{
+    prepareFmVoice();
+
+    for (int i = 0; i < NumPolyVoices; ++i) {
+        polyVoices[i].setParametersPool(voiceParameters());
+        polyVoices[i].setPatch(&voicePatch);
+        polyVoices[i].trigger(48 + i, 100);
+    }
+}
+
+static void processPolyFmVoices()
+{
+    ::memset(outL, 0, sizeof(outL));
+    ::memset(outR, 0, sizeof(outR));
+
+    for (auto& v : polyVoices)
+        v.process(outL, outR, BlockSize);
+
+    consume(outL);
+}
+
+static FmVoiceBank voiceBank;
+
+static void prepareFmVoiceBank()
+{
+    prepareFmVoice();
+
+    voiceBank.setParametersPool(voiceParameters());
+    voiceBank.setPatch(&voicePatch);
+
+    for (int i = 0; i < NumPolyVoices; ++i)
+        voiceBank.trigger(i, 48 + i, 100);
+}
+
+static void processFmVoiceBank()
+{
+    ::memset(outL, 0, sizeof(outL));
+    ::memset(outR, 0, sizeof(outR));
+    voiceBank.process(outL, outR, BlockSize);
+    consume(outL);
+}
+
+//==============================================================================
+
+// The whole engine with the same 16 notes, rendering the benchmark
+// block in internal blocks of different sizes (see Engine::setBlockSize()).
+static Engine* engine()
+{
+    static Engine e;
+    return &e;
+}
+
+// Engine time stamps in samples
+static uint32_t engineTime;
+
+static void processEngine()
+{
+    engineTime += BlockSize;
+    engine()->process(outL, outR, BlockSize, engineTime);
+    consume(outL);
+}
+
+template <size_t EngineBlockSize>
+static void prepareEngine()
+{
+    auto* e = engine();
+    e->setBlockSize(EngineBlockSize);
+
+    for (int i = 0; i < NumPolyVoices; ++i)
+        e->noteOn(1, 48 + i, 100, engineTime);
+
+    // Past the attacks, so that every block size starts from the same state.
+    for (int i = 0; i < 100; ++i)
+        processEngine();
+}
+
+//==============================================================================
+
+static Envelope envelope;
+
+static void prepareEnvelope()
+{
+    // Long decay keeps the envelope busy for the whole benchmark.
+    envelope.trigger({0.0f, 1000.0f, 0.0f, 1.0f});
+}
+
+static void processEnvelope()
+{
+    for (size_t i = 0; i < BlockSize; ++i)
+        outL[i] = envelope.next();
+
+    consume(outL);
+}
+
+static void processEnvelopeControlRate()
+{
+    envelope.process(outL, BlockSize);
+    consume(outL);
+}
+
+//==============================================================================
+
+static dsp::BiquadFilter::Spec biquadSpec;
+static dsp::BiquadFilter::State biquadState;
+
+static void prepareBiquad()
+{
+    biquadSpec.type = dsp::BiquadFilter::LowPass;
+    biquadSpec.sampleRate = globals::SAMPLE_RATE;
+    biquadSpec.freq = 1000.0f;
+    biquadSpec.q = 0.7071f;
+    biquadSpec.dbGain = 0.0f;
+    dsp::BiquadFilter::updateSpec(biquadSpec);
+    dsp::BiquadFilter::resetState(biquadSpec, biquadState);
+}
+
+static void processBiquad()
+{
+    dsp::BiquadFilter::process(biquadSpec, biquadState, inL, outL, BlockSize);
+    consume(outL);
+}
+
+//==============================================================================
+
+using Comb = dsp::CombFilter<1116>;
+using AllPass = dsp::AllPassFilter<556>;
+
+static Comb::Spec combSpec;
+static Comb::State combState;
+static AllPass::Spec allPassSpec;
+static AllPass::State allPassState;
+
+static void prepareComb()
+{
+    combSpec.feedback = 0.84f;
+    combSpec.damp = 0.2f;
+    Comb::resetState(combSpec, combState);
+}
+
+static void processComb()
+{
+    for (size_t i = 0; i < BlockSize; ++i)
+        outL[i] = Comb::tick(combSpec, combState, inL[i]);
+
+    consume(outL);
+}
+
+static void prepareAllPass()
+{
+    allPassSpec.feedback = 0.5f;
+    AllPass::resetState(allPassSpec, allPassState);
+}
+
+static void processAllPass()
+{
+    for (size_t i = 0; i < BlockSize; ++i)
+        outL[i] = AllPass::tick(allPassSpec, allPassState, inL[i]);
+
+    consume(outL);
+}
+
+//==============================================================================
+
+// The mono kernels run on the channels of the stereo state.
+using StereoReverb = dsp::StereoReverb<23>;
+using ReverbL = StereoReverb::Left;
+using ReverbR = StereoReverb::Right;
+
+static ReverbL::Spec reverbLSpec;
+static ReverbR::Spec reverbRSpec;
+static StereoReverb::Spec reverbSpec;
+static StereoReverb::State reverbState;
+
+static void prepareReverb()
+{
+    reverbLSpec.roomsize = reverbRSpec.roomsize = reverbSpec.roomsize = 0.87f;
+    reverbLSpec.damp = reverbRSpec.damp = reverbSpec.damp = 0.2f;
+    ReverbL::updateSpec(reverbLSpec);
+    ReverbR::updateSpec(reverbRSpec);
+    StereoReverb::updateSpec(reverbSpec);
+    StereoReverb::resetState(reverbSpec, reverbState);
+}
+
+static void processReverb()
+{
+    ReverbL::process(reverbLSpec, reverbState.left, inL, outL, BlockSize);
+    consume(outL);
+}
+
+static void processReverbLR()
+{
+    ReverbL::process(reverbLSpec, reverbState.left, inL, outL, BlockSize);
+    ReverbR::process(reverbRSpec, reverbState.right, inR, outR, BlockSize);
+    consume(outL);
+    consume(outR);
+}
+
+static void processStereoReverb()
+{
+    StereoReverb::process(reverbSpec, reverbState, inL, inR, outL, outR, BlockSize);
+    consume(outL);
+    consume(outR);
+}
+
+//==============================================================================
+
+static fx::Reverb* reverb()
+{
+    static fx::Reverb r;
+    return &r;
+}
+
+static void prepareFxReverb()
+{
+    reverb()->parameters()[fx::Reverb::ROOM_SIZE].setValue(0.87f, true);
+}
+
+static void processFxReverb()
+{
+    reverb()->process(inL, inR, outL, outR, BlockSize);
+    consume(outL);
+    consume(outR);
+}
+
+static fx::FdnReverb* fdnReverb()
+{
+    static fx::FdnReverb r;
+    return &r;
+}
+
+template <fx::FdnReverb::Quality Q>
+static void prepareFdnReverb()
+{
+    fdnReverb()->parameters()[fx::FdnReverb::ROOM_SIZE].setValue(0.87f, true);
+    fdnReverb()->setQuality(Q);
+}
+
+// A tier that did not fit the arena falls back to a lower one.
+template <fx::FdnReverb::Quality Q>
+static bool fdnReverbAllocated()
+{
+    return fdnReverb()->quality() == Q && fdnReverb()->memorySize() > 0;
+}
+
+static void processFdnReverb()
+{
+    fdnReverb()->process(inL, inR, outL, outR, BlockSize);
+    consume(outL);
+    consume(outR);
+}
+
+//==============================================================================
+
+// Constructed on first use, so that the arena is not taken when not benchmarking.
+static dsp::DelayLine& delayLine()
+{
+    static dsp::DelayLine line(4096);
+    return line;
+}
+
+static void prepareDelayLine()
+{
+    for (size_t i = 0; i < delayLine().size(); ++i)
+        delayLine().write(inL[i % BlockSize]);
+}
+
+static bool delayLineAllocated()
+{
+    return delayLine().size() == 4096;
+}
+
+static void processDelayLine()
+{
+    for (size_t i = 0; i < BlockSize; ++i)
+        outL[i] = delayLine().read(100.25f + 17.37f * float(i));
+
+    consume(outL);
+}
+
+//==============================================================================
+
+static fx::PitchShift* pitchShift()
+{
+    static fx::PitchShift ps;
+    return &ps;
+}
+
+static void preparePitchShift()
+{
+    pitchShift()->parameters()[fx::PitchShift::PITCH].setValue(1.5f, true);
+}
+
+static bool pitchShiftAllocated()
+{
+    return pitchShift()->delaySize() > 1;
+}
+
+static void processPitchShift()
+{
+    pitchShift()->process(inL, inR, outL, outR, BlockSize);
+    consume(outL);
+    consume(outR);
+}
+
+// Dry/wet changing every block, as when following a controller.
+static void processPitchShiftRamp()
+{
+    static bool flip = false;
+    auto& params = pitchShift()->parameters();
+
+    flip = ! flip;
+    params[fx::PitchShift::WET].setValue(flip ? 0.25f : 0.75f);
+    params[fx::PitchShift::DRY].setValue(flip ? 0.75f : 0.25f);
+    params.update(BlockSize);
+
+    pitchShift()->process(inL, inR, outL, outR, BlockSize);
+    consume(outL);
+    consume(outR);
+}
+
+//==============================================================================
+
+static int16_t pcmL[BlockSize];
+static int16_t pcmR[BlockSize];
+static int16_t pcm[BlockSize * 2];
+static int32_t pcm24[BlockSize * 2];
+static convert::Dither dither;
+
+static void prepareConvert()
+{
+}
+
+static void consumePcm()
+{
+    int s = 0;
+
+    for (size_t i = 0; i < BlockSize * 2; ++i)
+        s += pcm[i];
+
+    sink = sink + float(s);
+}
+
+// The block path: per sample conversion, then interleaved by the I2S output.
+static void processConvertBlocks()
+{
+    float maxL = 0.0f;
+    float maxR = 0.0f;
+
+    for (size_t i = 0; i < BlockSize; ++i) {
+        const float l = math::clamp(-1.0f, 1.0f, inL[i]);
+        const float r = math::clamp(-1.0f, 1.0f, inR[i]);
+
+        maxL = std::max(maxL, fabsf(l));
+        maxR = std::max(maxR, fabsf(r));
+
+        pcmL[i] = (int16_t) (l * 32767.0f);
+        pcmR[i] = (int16_t) (r * 32767.0f);
+    }
+
+    convert::interleave(pcmL, pcmR, pcm, BlockSize);
+
+    sink = sink + maxL + maxR;
+    consumePcm();
+}
+
+static void processConvertInterleaved()
+{
+    const auto peak = convert::toInt16Interleaved(inL, inR, pcm, BlockSize);
+
+    sink = sink + peak.left + peak.right;
+    consumePcm();
+}
+
+static void processConvertDithered()
+{
+    const auto peak = convert::toInt16Dithered(inL, inR, pcm, BlockSize, dither);
+
+    sink = sink + peak.left + peak.right;
+    consumePcm();
+}
+
+static void processConvert24()
+{
+    const auto peak = convert::toInt24Interleaved(inL, inR, pcm24, BlockSize);
+
+    sink = sink + peak.left + peak.right + float(pcm24[0] >> 8) + float(pcm24[BlockSize * 2 - 1] >> 8);
+}
+
+//==============================================================================
+
+static const Kernel kernels[] = {
+    { "sineLUT",                     prepareSineLUT,    processSineLUT    },
+    { "sinf",                        prepareSineKernel, processSineKernel<sinfKernel> },
+    { "sine::table",                 prepareSineKernel, processSineKernel<sine::table> },
+    { "sine::quarter",               prepareSineKernel, processSineKernel<sine::quarter> },
+    { "sine::quarterLinear",         prepareSineKernel, processSineKernel<sine::quarterLinear> },
+    { "sine::quarterCubic",          prepareSineKernel, processSineKernel<sine::quarterCubic> },
+    { "sine::polynomial",            prepareSineKernel, processSineKernel<sine::polynomial> },
+    { "FmVoice::FmOp::tick",         prepareFmOp,       processFmOp       },
+    { "FmVoice::process",            prepareFmVoice,    processFmVoice    },
+    { "FmVoice::process carriers",   prepareFmVoiceCarriers, processFmVoice },
+    { "FmVoice::process masked",     prepareFmVoiceMasked, processFmVoice },
+    { "FmVoice::process x16",        preparePolyFmVoices, processPolyFmVoices },
+    { "FmVoiceBank::process x16",    prepareFmVoiceBank, processFmVoiceBank },
+    { "Engine::process x16 (128)",   prepareEngine<128>, processEngine     },
+    { "Engine::process x16 (64)",    prepareEngine<64>,  processEngine     },
+    { "Engine::process x16 (32)",    prepareEngine<32>,  processEngine     },
+    { "Engine::process x16 (16)",    prepareEngine<16>,  processEngine     },
+    { "Envelope::next",              prepareEnvelope,   processEnvelope   },
+    { "Envelope::process",           prepareEnvelope,   processEnvelopeControlRate },
+    { "dsp::BiquadFilter::process",  prepareBiquad,     processBiquad     },
+    { "dsp::CombFilter::tick",       prepareComb,       processComb       },
+    { "dsp::AllPassFilter::tick",    prepareAllPass,    processAllPass    },
+    { "dsp::Reverb<>::process",      prepareReverb,     processReverb     },
+    { "dsp::Reverb<>::process L+R",  prepareReverb,     processReverbLR   },
+    { "dsp::StereoReverb<>::process", prepareReverb,    processStereoReverb },
+    { "fx::Reverb::process",         prepareFxReverb,   processFxReverb   },
+    { "fx::FdnReverb::process High", prepareFdnReverb<fx::FdnReverb::Quality::High>,   processFdnReverb,
+                                     fdnReverbAllocated<fx::FdnReverb::Quality::High> },
+    { "fx::FdnReverb::process Medium", prepareFdnReverb<fx::FdnReverb::Quality::Medium>, processFdnReverb,
+                                     fdnReverbAllocated<fx::FdnReverb::Quality::Medium> },
+    { "fx::FdnReverb::process Low",  prepareFdnReverb<fx::FdnReverb::Quality::Low>,    processFdnReverb,
+                                     fdnReverbAllocated<fx::FdnReverb::Quality::Low> },
+    { "dsp::DelayLine::read",        prepareDelayLine,  processDelayLine,  delayLineAllocated },
+    { "fx::PitchShift::process (2ch)", preparePitchShift, processPitchShift, pitchShiftAllocated },
+    { "fx::PitchShift::process ramp",  preparePitchShift, processPitchShiftRamp, pitchShiftAllocated },
+    { "convert blocks + interleave",   prepareConvert,    processConvertBlocks },
+    { "convert::toInt16Interleaved",   prepareConvert,    processConvertInterleaved },
+    { "convert::toInt16Dithered",      prepareConvert,    processConvertDithered },
+    { "convert::toInt24Interleaved",   prepareConvert,    processConvert24 },
+};
+
+static void prepareInput()
+{
+    // Deterministic white noise
+    uint32_t x = 0x12345678;
+
+    for (size_t i = 0; i < BlockSize; ++i) {
+        x = x * 1664525u + 1013904223u;
+        inL[i] = float(int32_t(x)) * (0.5f / 2147483648.0f);
+        x = x * 1664525u + 1013904223u;
+        inR[i] = float(int32_t(x)) * (0.5f / 2147483648.0f);
+    }
+}
+
+void run(PrintFunc print, size_t numBlocks)
+{
+    char line[128];
+
+    prepareInput();
+
+    snprintf(line, sizeof(line), "Benchmark: %u blocks of %u samples, best of %d runs",
+             (unsigned) numBlocks, (unsigned) BlockSize, NumRuns);
+    print(line);
+
+    snprintf(line, sizeof(line), "%-32s %12s %14s%s", "kernel", "ns/sample", "Msamples/s",
+             CycleCounter::countsCycles ? "  cycles/sample" : "");
+    print(line);
+
+    for (const auto& kernel : kernels) {
+        CycleCounter::Ticks best = 0;
+
+        kernel.prepare();
+
+        // Without its memory the kernel would measure something else.
+        if (kernel.allocated != nullptr && ! kernel.allocated()) {
+            snprintf(line, sizeof(line), "%-32s skipped, out of arena memory", kernel.name);
+            print(line);
+            continue;
+        }
+
+        for (int run = 0; run < NumRuns; ++run) {
+            kernel.prepare();
+
+            const auto t0 = CycleCounter::now();
+
+            for (size_t block = 0; block < numBlocks; ++block)
+                kernel.process();
+
+            const auto ticks = CycleCounter::since(t0);
+
+            if (run == 0 || ticks < best)
+                best = ticks;
+        }
+
+        const float numSamples = float(numBlocks * BlockSize);
+        const float seconds = float(best) / CycleCounter::ticksPerSecond();
+        const float nsPerSample = 1e9f * seconds / numSamples;
+        const float msps = 1e-6f * numSamples / seconds;
+
+        if (CycleCounter::countsCycles) {
+            snprintf(line, sizeof(line), "%-32s %12.2f %14.2f %14.2f", kernel.name,
+                     nsPerSample, msps, float(best) / numSamples);
+        } else {
+            snprintf(line, sizeof(line), "%-32s %12.2f %14.2f", kernel.name, nsPerSample, msps);
+        }
+
+        print(line);
+    }
+
+    print("");
+    reportSineQuality(print);
+
+    print("");
+    mem::report(print);
+}
+
+} // namespace bench
+
+#endif // ENGINE_BENCHMARK
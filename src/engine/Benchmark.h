@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+
+/**
+ * @brief Micro-benchmarks of the DSP kernels.
+ *
+ * Every kernel is timed in isolation over audio blocks of
+ * globals::AUDIO_BLOCK_SIZE samples. Results are reported as
+ * nanoseconds per sample and samples per second, plus CPU cycles
+ * per sample when running on the device. Only built with
+ * ENGINE_BENCHMARK, see src/Makefile.
+ */
+namespace bench {
+
+/// Receives one line of the report at a time (without line ending).
+using PrintFunc = void (*)(const char* line);
+
+constexpr size_t DefaultNumBlocks = 2000;
+
+void run(PrintFunc print, size_t numBlocks = DefaultNumBlocks);
+
+} // namespace bench
@@ -0,0 +1,95 @@
+#include <cmath>
+#include "engine/ControllerMap.h"
+
+namespace {
+
+// Steepness of the exponential and logarithmic curves.
+constexpr float CurveExponent = 4.0f;
+
+} // anonymous namespace
+
+ControllerMap::ControllerMap()
+{
+    clear();
+}
+
+bool ControllerMap::add(int cc, const Route& route)
+{
+    if (! isValid(cc) || m_numRoutes == MAX_ROUTES)
+        return false;
+
+    auto& entry = m_entries[cc];
+
+    if (entry.count == 0)
+        entry.first = uint8_t(m_numRoutes);
+
+    // Make room at the end of the controller routes.
+    const size_t position = entry.first + entry.count;
+
+    for (size_t i = m_numRoutes; i > position; --i)
+        m_routes[i] = m_routes[i - 1];
+
+    for (auto& other : m_entries) {
+        if (&other != &entry && other.count > 0 && other.first >= position)
+            other.first += 1;
+    }
+
+    m_routes[position] = route;
+    entry.count += 1;
+    m_numRoutes += 1;
+
+    return true;
+}
+
+void ControllerMap::clear(int cc)
+{
+    if (! isValid(cc))
+        return;
+
+    auto& entry = m_entries[cc];
+    const size_t count = entry.count;
+
+    if (count == 0)
+        return;
+
+    for (size_t i = entry.first; i + count < m_numRoutes; ++i)
+        m_routes[i] = m_routes[i + count];
+
+    for (auto& other : m_entries) {
+        if (other.count > 0 && other.first > entry.first)
+            other.first -= uint8_t(count);
+    }
+
+    entry.first = 0;
+    entry.count = 0;
+    m_numRoutes -= count;
+}
+
+void ControllerMap::clear()
+{
+    for (auto& entry : m_entries)
+        entry = Entry { 0, 0, false };
+
+    m_numRoutes = 0;
+    m_msb.fill(0);
+}
+
+void ControllerMap::setHighResolution(int cc, bool enabled)
+{
+    if (cc >= 0 && cc < NUM_HIGH_RESOLUTION)
+        m_entries[cc].highResolution = enabled;
+}
+
+float ControllerMap::shape(Curve curve, float x)
+{
+    const float range = expf(CurveExponent) - 1.0f;
+
+    switch (curve) {
+        case Curve::Exponential:
+            return (expf(CurveExponent * x) - 1.0f) / range;
+        case Curve::Logarithmic:
+            return logf(1.0f + range * x) / CurveExponent;
+        default:
+            return x;
+    }
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @brief MIDI controllers (CC) to parameters routing.
+ *
+ * Every controller owns a contiguous run of routes in a fixed array,
+ * found through a flat 128-entry table: a CC message costs one table
+ * lookup and a loop over its own routes, with no search or allocation.
+ * A controller can drive several parameters, each route with its own
+ * range, response curve and inversion.
+ *
+ * Controllers 0..31 can be paired with their LSB controllers 32..63
+ * for 14-bit values. As per the MIDI specification, a new MSB resets
+ * the LSB to zero.
+ *
+ * Routes are set up from the main thread before playing, or with
+ * the audio interrupt locked.
+ */
+class ControllerMap final
+{
+public:
+
+    constexpr static int NUM_CONTROLLERS = 128;
+
+    /// Controllers below this one can be paired with controller + LSB_OFFSET.
+    constexpr static int NUM_HIGH_RESOLUTION = 32;
+    constexpr static int LSB_OFFSET = 32;
+
+    /// Routes shared by all the controllers.
+    constexpr static size_t MAX_ROUTES = 64;
+
+    enum class Curve : uint8_t
+    {
+        Linear,
+        Exponential,    // Slow start, for levels and times
+        Logarithmic     // Fast start, the inverse of Exponential
+    };
+
+    struct Route
+    {
+        int parameter = 0;
+        float min = 0.0f;
+        float max = 1.0f;
+        Curve curve = Curve::Linear;
+        bool invert = false;
+    };
+
+    ControllerMap();
+
+    /// Add a route to the controller, returns false if out of routes or the controller is invalid.
+    bool add(int cc, const Route& route);
+
+    /// Remove the routes of a controller.
+    void clear(int cc);
+
+    /// Remove all the routes and 14-bit pairs.
+    void clear();
+
+    size_t numRoutes(int cc) const noexcept { return isValid(cc) ? m_entries[cc].count : 0; }
+
+    /// Pair an MSB controller (0..31) with its LSB controller for 14-bit values.
+    void setHighResolution(int cc, bool enabled);
+    bool isHighResolution(int cc) const noexcept { return cc >= 0 && cc < NUM_HIGH_RESOLUTION && m_entries[cc].highResolution; }
+
+    /// Curve applied to a normalized value, 0..1 to 0..1.
+    static float shape(Curve curve, float x);
+
+    /**
+     * @brief Handle a CC message.
+     *
+     * Calls f(parameter, value) for every route of the controller.
+     */
+    template <typename F>
+    void apply(int cc, int value, F&& f)
+    {
+        if (! isValid(cc))
+            return;
+
+        if (cc < NUM_HIGH_RESOLUTION) {
+            m_msb[cc] = uint8_t(value & 0x7F);
+
+            if (m_entries[cc].highResolution) {
+                applyRoutes(cc, float(m_msb[cc] << 7) * (1.0f / 16383.0f), f);
+                return;
+            }
+        } else if (cc < NUM_HIGH_RESOLUTION + LSB_OFFSET && m_entries[cc - LSB_OFFSET].highResolution) {
+            const int msb = cc - LSB_OFFSET;
+            applyRoutes(msb, float((m_msb[msb] << 7) | (value & 0x7F)) * (1.0f / 16383.0f), f);
+            return;
+        }
+
+        applyRoutes(cc, float(value) * (1.0f / 127.0f), f);
+    }
+
+private:
+
+    struct Entry
+    {
+        uint8_t first;
+        uint8_t count;
+        bool highResolution;
+    };
+
+    static bool isValid(int cc) { return cc >= 0 && cc < NUM_CONTROLLERS; }
+
+    template <typename F>
+    void applyRoutes(int cc, float x, F& f)
+    {
+        const auto& entry = m_entries[cc];
+
+        for (size_t i = entry.first; i < size_t(entry.first + entry.count); ++i) {
+            const auto& route = m_routes[i];
+            const float v = route.curve == Curve::Linear && ! route.invert ? x : shape(route.curve, route.invert ? 1.0f - x : x);
+
+            f(route.parameter, route.min + (route.max - route.min) * v);
+        }
+    }
+
+    std::array<Entry, NUM_CONTROLLERS> m_entries;
+    std::array<Route, MAX_ROUTES> m_routes;
+    size_t m_numRoutes;
+
+    // Last MSB of the 14-bit controllers
+    std::array<uint8_t, NUM_HIGH_RESOLUTION> m_msb;
+};
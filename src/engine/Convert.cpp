@@ -0,0 +1,241 @@
+#include <cmath>
+#include <algorithm>
+#include "engine/Convert.h"
+#include "engine/Simd.h"
+
+namespace convert {
+
+namespace {
+
+using simd::float4;
+
+constexpr float SCALE = 32767.0f;
+
+inline float4 clamp(float4 x)
+{
+    return simd::min(simd::max(x, float4(-1.0f)), float4(1.0f));
+}
+
+inline float maxLane(float4 x)
+{
+    alignas(16) float v[simd::LANES];
+    x.store(v);
+
+    return std::max(std::max(v[0], v[1]), std::max(v[2], v[3]));
+}
+
+// Converts the frames left over by the vector loop.
+template <bool Interleaved>
+Peak convertTail(const float* inL, const float* inR, int16_t* outL, int16_t* outR, size_t numFrames, Peak peak)
+{
+    for (size_t i = 0; i < numFrames; ++i) {
+        peak.left = std::max(peak.left, fabsf(math::clamp(-1.0f, 1.0f, inL[i])));
+        peak.right = std::max(peak.right, fabsf(math::clamp(-1.0f, 1.0f, inR[i])));
+
+        if (Interleaved) {
+            outL[2 * i] = toInt16(inL[i]);
+            outL[2 * i + 1] = toInt16(inR[i]);
+        } else {
+            outL[i] = toInt16(inL[i]);
+            outR[i] = toInt16(inR[i]);
+        }
+    }
+
+    return peak;
+}
+
+inline simd::uint4 next(simd::uint4 x)
+{
+    x = x ^ simd::shiftLeft<13>(x);
+    x = x ^ simd::shiftRight<17>(x);
+    x = x ^ simd::shiftLeft<5>(x);
+    return x;
+}
+
+// Same as Dither::tpdf() for 4 words.
+inline float4 tpdf(simd::uint4 r)
+{
+    const simd::uint4 one(0x3f800000u);
+    const simd::uint4 low(0xffffu);
+
+    const float4 a = simd::asFloat(simd::shiftLeft<7>(r & low) | one);
+    const float4 b = simd::asFloat(simd::shiftLeft<7>(simd::shiftRight<16>(r)) | one);
+
+    return a - b;
+}
+
+// Rounded half away from zero by the truncating conversion.
+inline float4 roundOffset(float4 y)
+{
+    const simd::uint4 sign(0x80000000u);
+    return y + simd::asFloat((simd::asUint(y) & sign) | simd::asUint(float4(0.5f)));
+}
+
+// Dithered conversion into interleaved frames (outL) or separate channels.
+template <bool Interleaved>
+Peak convertDithered(const float* inL, const float* inR, int16_t* outL, int16_t* outR, size_t numFrames,
+                     Dither& dither)
+{
+    const float4 scale(SCALE);
+    float4 peakL(0.0f);
+    float4 peakR(0.0f);
+
+    simd::uint4 seedL = simd::uint4::load(dither.left);
+    simd::uint4 seedR = simd::uint4::load(dither.right);
+
+    size_t i = 0;
+
+    for (; i + simd::LANES <= numFrames; i += simd::LANES) {
+        seedL = next(seedL);
+        seedR = next(seedR);
+
+        const float4 l = clamp(float4::load(inL + i));
+        const float4 r = clamp(float4::load(inR + i));
+
+        peakL = simd::max(peakL, simd::abs(l));
+        peakR = simd::max(peakR, simd::abs(r));
+
+        const float4 dl = roundOffset(l * scale + tpdf(seedL));
+        const float4 dr = roundOffset(r * scale + tpdf(seedR));
+
+        if (Interleaved) {
+            simd::toInt16Interleaved(dl, dr, outL + 2 * i);
+        } else {
+            simd::toInt16(dl, outL + i);
+            simd::toInt16(dr, outR + i);
+        }
+    }
+
+    seedL.store(dither.left);
+    seedR.store(dither.right);
+
+    Peak peak;
+    peak.left = maxLane(peakL);
+    peak.right = maxLane(peakR);
+
+    for (size_t lane = 0; i < numFrames; ++i, ++lane) {
+        peak.left = std::max(peak.left, fabsf(math::clamp(-1.0f, 1.0f, inL[i])));
+        peak.right = std::max(peak.right, fabsf(math::clamp(-1.0f, 1.0f, inR[i])));
+
+        const int16_t l = toInt16(inL[i], Dither::tpdf(Dither::next(dither.left[lane])));
+        const int16_t r = toInt16(inR[i], Dither::tpdf(Dither::next(dither.right[lane])));
+
+        if (Interleaved) {
+            outL[2 * i] = l;
+            outL[2 * i + 1] = r;
+        } else {
+            outL[i] = l;
+            outR[i] = r;
+        }
+    }
+
+    return peak;
+}
+
+} // anonymous namespace
+
+Peak toInt16(const float* inL, const float* inR, int16_t* outL, int16_t* outR, size_t numFrames)
+{
+    const float4 scale(SCALE);
+    float4 peakL(0.0f);
+    float4 peakR(0.0f);
+
+    size_t i = 0;
+
+    for (; i + simd::LANES <= numFrames; i += simd::LANES) {
+        const float4 l = clamp(float4::load(inL + i));
+        const float4 r = clamp(float4::load(inR + i));
+
+        peakL = simd::max(peakL, simd::abs(l));
+        peakR = simd::max(peakR, simd::abs(r));
+
+        simd::toInt16(l * scale, outL + i);
+        simd::toInt16(r * scale, outR + i);
+    }
+
+    Peak peak;
+    peak.left = maxLane(peakL);
+    peak.right = maxLane(peakR);
+
+    return convertTail<false>(inL + i, inR + i, outL + i, outR + i, numFrames - i, peak);
+}
+
+Peak toInt16Interleaved(const float* inL, const float* inR, int16_t* out, size_t numFrames)
+{
+    const float4 scale(SCALE);
+    float4 peakL(0.0f);
+    float4 peakR(0.0f);
+
+    size_t i = 0;
+
+    for (; i + simd::LANES <= numFrames; i += simd::LANES) {
+        const float4 l = clamp(float4::load(inL + i));
+        const float4 r = clamp(float4::load(inR + i));
+
+        peakL = simd::max(peakL, simd::abs(l));
+        peakR = simd::max(peakR, simd::abs(r));
+
+        simd::toInt16Interleaved(l * scale, r * scale, out + 2 * i);
+    }
+
+    Peak peak;
+    peak.left = maxLane(peakL);
+    peak.right = maxLane(peakR);
+
+    return convertTail<true>(inL + i, inR + i, out + 2 * i, nullptr, numFrames - i, peak);
+}
+
+Peak toInt16Dithered(const float* inL, const float* inR, int16_t* outL, int16_t* outR, size_t numFrames,
+                     Dither& dither)
+{
+    return convertDithered<false>(inL, inR, outL, outR, numFrames, dither);
+}
+
+Peak toInt16Dithered(const float* inL, const float* inR, int16_t* out, size_t numFrames, Dither& dither)
+{
+    return convertDithered<true>(inL, inR, out, nullptr, numFrames, dither);
+}
+
+Peak toInt24Interleaved(const float* inL, const float* inR, int32_t* out, size_t numFrames)
+{
+    const float4 scale(8388607.0f);
+    const float4 justify(256.0f);
+    float4 peakL(0.0f);
+    float4 peakR(0.0f);
+
+    size_t i = 0;
+
+    for (; i + simd::LANES <= numFrames; i += simd::LANES) {
+        const float4 l = clamp(float4::load(inL + i));
+        const float4 r = clamp(float4::load(inR + i));
+
+        peakL = simd::max(peakL, simd::abs(l));
+        peakR = simd::max(peakR, simd::abs(r));
+
+        simd::toIntInterleaved(simd::trunc(l * scale) * justify, simd::trunc(r * scale) * justify, out + 2 * i);
+    }
+
+    Peak peak;
+    peak.left = maxLane(peakL);
+    peak.right = maxLane(peakR);
+
+    for (; i < numFrames; ++i) {
+        peak.left = std::max(peak.left, fabsf(math::clamp(-1.0f, 1.0f, inL[i])));
+        peak.right = std::max(peak.right, fabsf(math::clamp(-1.0f, 1.0f, inR[i])));
+
+        out[2 * i] = toInt24(inL[i]);
+        out[2 * i + 1] = toInt24(inR[i]);
+    }
+
+    return peak;
+}
+
+void interleave(const int16_t* inL, const int16_t* inR, int16_t* out, size_t numFrames)
+{
+    for (size_t i = 0; i < numFrames; ++i) {
+        out[2 * i] = inL[i];
+        out[2 * i + 1] = inR[i];
+    }
+}
+
+} // namespace convert
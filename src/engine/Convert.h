@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include "engine/Globals.h"
+#include "engine/Simd.h"
+
+/**
+ * Conversion of the engine float output to the 16-bit output samples.
+ *
+ * Samples are clamped to [-1, 1] and truncated after scaling by 32767,
+ * the vectorised kernels match toInt16() bit for bit. The 24-bit
+ * conversion is meant for the direct output, see AudioOutputI2S.
+ */
+
+namespace convert {
+
+/// Absolute peak of the clamped samples of a block.
+struct Peak
+{
+    float left = 0.0f;
+    float right = 0.0f;
+};
+
+/**
+ * @brief TPDF dither noise, xorshift32 generators.
+ *
+ * Every random word gives two 16-bit uniform values in [1, 2) built
+ * straight into the float mantissa, their difference is a triangular
+ * distribution over +/-1 LSB: the truncation distortion of quiet
+ * signals turns into a constant, signal independent noise. Each
+ * channel has a generator per vector lane, frame i uses lane i % 4.
+ */
+struct Dither
+{
+    uint32_t left[simd::LANES] = { 0x9e3779b9u, 0x6a09e667u, 0xbb67ae85u, 0x3c6ef372u };
+    uint32_t right[simd::LANES] = { 0xa54ff53au, 0x510e527fu, 0x9b05688cu, 0x1f83d9abu };
+
+    static uint32_t next(uint32_t& x)
+    {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        return x;
+    }
+
+    /// Noise in LSB from a random word, (-1, 1).
+    static float tpdf(uint32_t r)
+    {
+        const uint32_t a = ((r & 0xffff) << 7) | 0x3f800000u;
+        const uint32_t b = ((r >> 16) << 7) | 0x3f800000u;
+
+        float fa, fb;
+        ::memcpy(&fa, &a, sizeof(fa));
+        ::memcpy(&fb, &b, sizeof(fb));
+
+        return fa - fb;
+    }
+};
+
+/// Reference conversion of a single sample.
+inline int16_t toInt16(float x)
+{
+    return (int16_t) (math::clamp(-1.0f, 1.0f, x) * 32767.0f);
+}
+
+/// Reference dithered conversion of a single sample, noise in LSB, rounded half away from zero.
+inline int16_t toInt16(float x, float noise)
+{
+    const float y = math::clamp(-1.0f, 1.0f, x) * 32767.0f + noise;
+    const int32_t i = int32_t(y + std::copysign(0.5f, y));
+    return (int16_t) (i > 32767 ? 32767 : (i < -32768 ? -32768 : i));
+}
+
+/// Reference conversion to a 24-bit sample left-justified in 32 bits.
+inline int32_t toInt24(float x)
+{
+    return int32_t(math::clamp(-1.0f, 1.0f, x) * 8388607.0f) * 256;
+}
+
+/**
+ * @brief Convert a stereo block into separate left and right buffers.
+ *
+ * The input buffers must be 16-byte aligned.
+ */
+Peak toInt16(const float* inL, const float* inR, int16_t* outL, int16_t* outR, size_t numFrames);
+
+/**
+ * @brief Convert a stereo block into interleaved frames, L R L R ...
+ *
+ * This is the I2S DMA buffer layout, see AudioOutputI2S.
+ * The input buffers must be 16-byte aligned.
+ */
+Peak toInt16Interleaved(const float* inL, const float* inR, int16_t* out, size_t numFrames);
+
+/**
+ * @brief Convert a stereo block TPDF dithered and rounded to the nearest.
+ *
+ * Matches toInt16(x, noise) with the noise taken from the dither
+ * generators in frame order. The input buffers must be 16-byte aligned.
+ */
+Peak toInt16Dithered(const float* inL, const float* inR, int16_t* outL, int16_t* outR, size_t numFrames,
+                     Dither& dither);
+
+/// Same as the above into interleaved frames, L R L R ...
+Peak toInt16Dithered(const float* inL, const float* inR, int16_t* out, size_t numFrames, Dither& dither);
+
+/**
+ * @brief Convert a stereo block into interleaved 24-bit frames.
+ *
+ * Samples are left-justified in 32-bit words, the I2S slot layout
+ * with AUDIO_OUTPUT_24BIT. The input buffers must be 16-byte aligned.
+ */
+Peak toInt24Interleaved(const float* inL, const float* inR, int32_t* out, size_t numFrames);
+
+/// Interleave separate 16-bit buffers, L R L R ...
+void interleave(const int16_t* inL, const int16_t* inR, int16_t* out, size_t numFrames);
+
+} // namespace convert
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <Arduino.h>
+
+#if !defined(__IMXRT1062__)
+#   include <chrono>
+#endif
+
+namespace perf {
+
+/**
+ * @brief Free-running high resolution time counter.
+ *
+ * On the IMXRT1062 this reads the Cortex-M7 DWT cycle counter
+ * (enabled by the startup code), so ticks are CPU cycles.
+ * On the host it falls back to std::chrono::steady_clock
+ * with nanosecond ticks.
+ */
+struct CycleCounter
+{
+#if defined(__IMXRT1062__)
+    using Ticks = uint32_t;
+
+    constexpr static bool countsCycles = true;
+
+    static inline Ticks now() { return ARM_DWT_CYCCNT; }
+    static inline float ticksPerSecond() { return float(F_CPU_ACTUAL); }
+#else
+    using Ticks = uint64_t;
+
+    constexpr static bool countsCycles = false;
+
+    static inline Ticks now()
+    {
+        using namespace std::chrono;
+        return (Ticks) duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+    }
+
+    static inline float ticksPerSecond() { return 1e9f; }
+#endif
+
+    /// Ticks elapsed since the given time stamp (wrap-around safe).
+    static inline Ticks since(Ticks t) { return now() - t; }
+
+    static inline float toMicroseconds(Ticks t) { return 1e6f * float(t) / ticksPerSecond(); }
+};
+
+} // namespace perf
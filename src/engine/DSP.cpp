@@ -3,28 +3,40 @@
 
 namespace dsp {
 
-DelayLine::DelayLine(size_t size)
-    : m_buffer (size, 0.0f)
+DelayLine::DelayLine(size_t size, mem::Region region)
+    : m_buffer (&m_sample)
+    , m_size (1)
+    , m_capacity (1)
     , m_writeIndex (0)
+    , m_region (region)
+    , m_sample (0.0f)
 {
+    resize(size);
 }
 
 void DelayLine::resize(size_t size)
 {
-    m_buffer.resize(size);
+    if (size > m_capacity) {
+        if (float* buffer = mem::allocate<float>(m_region, size)) {
+            m_buffer = buffer;
+            m_capacity = size;
+        }
+    }
+
+    m_size = std::max<size_t>(1, std::min(size, m_capacity));
     reset();
 }
 
 void DelayLine::reset()
 {
     m_writeIndex = 0;
-    ::memset(m_buffer.data(), 0, sizeof(float) * m_buffer.size());
+    ::memset(m_buffer, 0, sizeof(float) * m_size);
 }
 
 void DelayLine::write(float x)
 {
     if (m_writeIndex == 0)
-        m_writeIndex = m_buffer.size() - 1;
+        m_writeIndex = m_size - 1;
     else
         --m_writeIndex;
 
@@ -36,16 +48,16 @@ float DelayLine::read(float delay) const
     int index = (int)floor(delay);
     const float frac = delay - (float)index;
 
-    index = (index + m_writeIndex) % (int)m_buffer.size();
+    index = (index + m_writeIndex) % (int)m_size;
     const auto a = m_buffer[index];
-    const auto b = index < (int) m_buffer.size() - 1 ? m_buffer[index + 1] : m_buffer[0];
+    const auto b = index < (int) m_size - 1 ? m_buffer[index + 1] : m_buffer[0];
 
     return math::lerp(a, b, frac);
 }
 
 float DelayLine::readNoInterp(int delay) const
 {
-    const int index = (delay + m_writeIndex) % (int)m_buffer.size();
+    const int index = (delay + m_writeIndex) % (int)m_size;
     return m_buffer[index];
 }
 
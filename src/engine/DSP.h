@@ -1,30 +1,43 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
-#include <vector>
 #include <cstring>
+#include "engine/Arena.h"
 
 namespace dsp {
 
 /**
  * @brief Delay line with linear-interpolated reads.
+ *
+ * The buffer comes from the memory arena (bulk region by default).
+ * Shrinking reuses it, growing takes a new one from the arena, so the
+ * line should be sized once at init. Without memory (zero size or an
+ * exhausted arena) the line holds a single sample.
  */
 class DelayLine
 {
 public:
 
-    DelayLine(size_t size = 1024);
+    DelayLine(size_t size = 0, mem::Region region = mem::Region::Bulk);
+    DelayLine(const DelayLine&) = delete;
+    DelayLine& operator = (const DelayLine&) = delete;
+
     void resize(size_t size);
     void reset();
     void write(float x);
     float read(float delay) const;
     float readNoInterp(int delay) const;
 
-    size_t size() const { return m_buffer.size(); }
+    size_t size() const { return m_size; }
 
 private:
-    std::vector<float> m_buffer;
+    float* m_buffer;
+    size_t m_size;
+    size_t m_capacity;
     size_t m_writeIndex;
+    mem::Region m_region;
+    float m_sample;
 };
 
 //==============================================================================
@@ -121,10 +134,39 @@ struct AllPassFilter
         ::memset(state.buffer.data(), 0, sizeof (float) * state.buffer.size());
     }
 
+    /**
+     * @brief Filter a block, in place if in == out.
+     *
+     * The buffer is walked in contiguous spans split at its end, without
+     * modulo. Same output as tick() on every sample.
+     */
     static void process(const Spec& spec, State& state, const float* in, float* out, size_t size)
     {
-        for (size_t i = 0; i < size; ++i)
-            out[i] = tick(spec, state, in[i]);
+        const float feedback = spec.feedback;
+        size_t index = state.index;
+
+        while (size > 0) {
+            const size_t n = std::min(size, size_t(Size) - index);
+            float* buffer = state.buffer.data() + index;
+
+            for (size_t i = 0; i < n; ++i) {
+                const float x = in[i];
+                const float bufOut = buffer[i];
+                buffer[i] = x + (bufOut * feedback);
+                out[i] = bufOut - x;
+            }
+
+            index += n;
+
+            if (index == size_t(Size))
+                index = 0;
+
+            in += n;
+            out += n;
+            size -= n;
+        }
+
+        state.index = int(index);
     }
 
     inline static float tick(const Spec& spec, State& state, float x)
@@ -169,10 +211,43 @@ struct CombFilter
         ::memset(state.buffer.data(), 0, sizeof (float) * state.buffer.size());
     }
 
+    /**
+     * @brief Filter a block, in place if in == out.
+     *
+     * The buffer is walked in contiguous spans split at its end, without
+     * modulo. Same output as tick() on every sample.
+     */
     static void process(const Spec& spec, State& state, const float* in, float* out, size_t size)
     {
-        for (size_t i = 0; i < size; ++i)
-            out[i] = tick(spec, state, in[i]);
+        const float feedback = spec.feedback;
+        const float damp1 = spec.damp;
+        const float damp2 = 1.0f - spec.damp;
+        float filterStore = state.filterStore;
+        size_t index = state.index;
+
+        while (size > 0) {
+            const size_t n = std::min(size, size_t(Size) - index);
+            float* buffer = state.buffer.data() + index;
+
+            for (size_t i = 0; i < n; ++i) {
+                const float output = buffer[i];
+                filterStore = output * damp2 + filterStore * damp1;
+                buffer[i] = in[i] + filterStore * feedback;
+                out[i] = output;
+            }
+
+            index += n;
+
+            if (index == size_t(Size))
+                index = 0;
+
+            in += n;
+            out += n;
+            size -= n;
+        }
+
+        state.filterStore = filterStore;
+        state.index = int(index);
     }
 
     inline static float tick(const Spec& spec, State& state, float x)
@@ -187,6 +262,220 @@ struct CombFilter
 
 };
 
+namespace detail {
+
+/// Position in a comb filter buffer, for the kernels running several combs at once.
+template <int Size>
+struct CombCursor
+{
+    using State = typename CombFilter<Size>::State;
+
+    explicit CombCursor(State& s)
+        : state(s)
+        , filterStore(s.filterStore)
+        , index(size_t(s.index))
+    {}
+
+    size_t span() const { return size_t(Size) - index; }
+    float* data() { return state.buffer.data() + index; }
+
+    void advance(size_t n)
+    {
+        index += n;
+
+        if (index == size_t(Size))
+            index = 0;
+    }
+
+    void store()
+    {
+        state.filterStore = filterStore;
+        state.index = int(index);
+    }
+
+    State& state;
+    float filterStore;
+    size_t index;
+};
+
+} // namespace detail
+
+/**
+ * @brief Run two comb filters over a block and add their outputs to out.
+ *
+ * out = (out + a) + b, or a + b if not accumulating, as when ticking the
+ * filters one after the other. The two damping filter recurrences are
+ * independent, interleaving them hides their latency.
+ */
+template <bool Accumulate, int SizeA, int SizeB>
+void processCombPair(const typename CombFilter<SizeA>::Spec& specA, typename CombFilter<SizeA>::State& stateA,
+                     const typename CombFilter<SizeB>::Spec& specB, typename CombFilter<SizeB>::State& stateB,
+                     const float* in, float* out, size_t size)
+{
+    const float feedbackA = specA.feedback;
+    const float dampA1 = specA.damp;
+    const float dampA2 = 1.0f - specA.damp;
+    const float feedbackB = specB.feedback;
+    const float dampB1 = specB.damp;
+    const float dampB2 = 1.0f - specB.damp;
+
+    detail::CombCursor<SizeA> a(stateA);
+    detail::CombCursor<SizeB> b(stateB);
+
+    while (size > 0) {
+        const size_t n = std::min(size, std::min(a.span(), b.span()));
+        float* bufferA = a.data();
+        float* bufferB = b.data();
+
+        for (size_t i = 0; i < n; ++i) {
+            const float x = in[i];
+            const float outputA = bufferA[i];
+            const float outputB = bufferB[i];
+
+            a.filterStore = outputA * dampA2 + a.filterStore * dampA1;
+            b.filterStore = outputB * dampB2 + b.filterStore * dampB1;
+            bufferA[i] = x + a.filterStore * feedbackA;
+            bufferB[i] = x + b.filterStore * feedbackB;
+
+            if (Accumulate)
+                out[i] = (out[i] + outputA) + outputB;
+            else
+                out[i] = outputA + outputB;
+        }
+
+        a.advance(n);
+        b.advance(n);
+        in += n;
+        out += n;
+        size -= n;
+    }
+
+    a.store();
+    b.store();
+}
+
+/**
+ * @brief Stereo version of processCombPair().
+ *
+ * Runs the A and B combs of both channels in the same loop, with the
+ * same spec, so four damping filter recurrences are interleaved.
+ */
+template <bool Accumulate, int SizeLA, int SizeLB, int SizeRA, int SizeRB, typename CombSpec>
+void processCombPairStereo(const CombSpec& spec,
+                           typename CombFilter<SizeLA>::State& stateLA, typename CombFilter<SizeLB>::State& stateLB,
+                           typename CombFilter<SizeRA>::State& stateRA, typename CombFilter<SizeRB>::State& stateRB,
+                           const float* inL, const float* inR, float* outL, float* outR, size_t size)
+{
+    const float feedback = spec.feedback;
+    const float damp1 = spec.damp;
+    const float damp2 = 1.0f - spec.damp;
+
+    detail::CombCursor<SizeLA> la(stateLA);
+    detail::CombCursor<SizeLB> lb(stateLB);
+    detail::CombCursor<SizeRA> ra(stateRA);
+    detail::CombCursor<SizeRB> rb(stateRB);
+
+    while (size > 0) {
+        const size_t n = std::min(std::min(size, std::min(la.span(), lb.span())),
+                                  std::min(ra.span(), rb.span()));
+        float* bufferLA = la.data();
+        float* bufferLB = lb.data();
+        float* bufferRA = ra.data();
+        float* bufferRB = rb.data();
+
+        for (size_t i = 0; i < n; ++i) {
+            const float xL = inL[i];
+            const float xR = inR[i];
+            const float outputLA = bufferLA[i];
+            const float outputLB = bufferLB[i];
+            const float outputRA = bufferRA[i];
+            const float outputRB = bufferRB[i];
+
+            la.filterStore = outputLA * damp2 + la.filterStore * damp1;
+            lb.filterStore = outputLB * damp2 + lb.filterStore * damp1;
+            ra.filterStore = outputRA * damp2 + ra.filterStore * damp1;
+            rb.filterStore = outputRB * damp2 + rb.filterStore * damp1;
+
+            bufferLA[i] = xL + la.filterStore * feedback;
+            bufferLB[i] = xL + lb.filterStore * feedback;
+            bufferRA[i] = xR + ra.filterStore * feedback;
+            bufferRB[i] = xR + rb.filterStore * feedback;
+
+            if (Accumulate) {
+                outL[i] = (outL[i] + outputLA) + outputLB;
+                outR[i] = (outR[i] + outputRA) + outputRB;
+            } else {
+                outL[i] = outputLA + outputLB;
+                outR[i] = outputRA + outputRB;
+            }
+        }
+
+        la.advance(n);
+        lb.advance(n);
+        ra.advance(n);
+        rb.advance(n);
+        inL += n;
+        inR += n;
+        outL += n;
+        outR += n;
+        size -= n;
+    }
+
+    la.store();
+    lb.store();
+    ra.store();
+    rb.store();
+}
+
+/**
+ * @brief Run an all-pass filter of each channel over a block, in place if in == out.
+ */
+template <int SizeL, int SizeR, typename AllPassSpec>
+void processAllPassStereo(const AllPassSpec& spec,
+                          typename AllPassFilter<SizeL>::State& stateL, typename AllPassFilter<SizeR>::State& stateR,
+                          const float* inL, const float* inR, float* outL, float* outR, size_t size)
+{
+    const float feedback = spec.feedback;
+    size_t indexL = size_t(stateL.index);
+    size_t indexR = size_t(stateR.index);
+
+    while (size > 0) {
+        const size_t n = std::min(size, std::min(size_t(SizeL) - indexL, size_t(SizeR) - indexR));
+        float* bufferL = stateL.buffer.data() + indexL;
+        float* bufferR = stateR.buffer.data() + indexR;
+
+        for (size_t i = 0; i < n; ++i) {
+            const float xL = inL[i];
+            const float xR = inR[i];
+            const float bufOutL = bufferL[i];
+            const float bufOutR = bufferR[i];
+
+            bufferL[i] = xL + (bufOutL * feedback);
+            bufferR[i] = xR + (bufOutR * feedback);
+            outL[i] = bufOutL - xL;
+            outR[i] = bufOutR - xR;
+        }
+
+        indexL += n;
+        indexR += n;
+
+        if (indexL == size_t(SizeL))
+            indexL = 0;
+
+        if (indexR == size_t(SizeR))
+            indexR = 0;
+
+        inL += n;
+        inR += n;
+        outL += n;
+        outR += n;
+        size -= n;
+    }
+
+    stateL.index = int(indexL);
+    stateR.index = int(indexR);
+}
+
 //==============================================================================
 
 /**
@@ -293,31 +582,212 @@ struct Reverb
         AllPassFilter<allPassTuning4>::resetState(spec.allPass4, state.allPass4);
     }
 
+    /// Frames filtered at once, the size of the accumulator on the stack.
+    static constexpr size_t ChunkSize = 64;
+
+    /**
+     * @brief Filter a block, in place if in == out.
+     *
+     * Every filter runs over a whole chunk at a time: the combs are summed
+     * into an accumulator in the same order as per sample, then the all-pass
+     * filters run in place. The output is the same as ticking every filter
+     * on every sample.
+     */
     static void process(const Spec& spec, State& state, const float* in, float* out, size_t size)
     {
-        for (size_t i = 0; i < size; ++i) {
-            const auto x = in[i];
-
-            float y = CombFilter<combTuning1>::tick(spec.comb1, state.comb1, x);
-            y += CombFilter<combTuning2>::tick(spec.comb2, state.comb2, x);
-            y += CombFilter<combTuning3>::tick(spec.comb3, state.comb3, x);
-            y += CombFilter<combTuning4>::tick(spec.comb4, state.comb4, x);
-            y += CombFilter<combTuning5>::tick(spec.comb5, state.comb5, x);
-            y += CombFilter<combTuning6>::tick(spec.comb6, state.comb6, x);
-            y += CombFilter<combTuning7>::tick(spec.comb7, state.comb7, x);
-            y += CombFilter<combTuning8>::tick(spec.comb8, state.comb8, x);
-
-            y *= 0.125f; // normalize due to x8 combs added together 1/8
-
-            y = AllPassFilter<allPassTuning1>::tick(spec.allPass1, state.allPass1, y);
-            y = AllPassFilter<allPassTuning2>::tick(spec.allPass2, state.allPass2, y);
-            y = AllPassFilter<allPassTuning3>::tick(spec.allPass3, state.allPass3, y);
-            y = AllPassFilter<allPassTuning4>::tick(spec.allPass4, state.allPass4, y);
-
-            out[i] = y;
+        alignas(16) float acc[ChunkSize];
+
+        for (size_t offset = 0; offset < size; offset += ChunkSize) {
+            const size_t n = std::min(ChunkSize, size - offset);
+            const float* x = in + offset;
+
+            processCombPair<false, combTuning1, combTuning2>(spec.comb1, state.comb1, spec.comb2, state.comb2, x, acc, n);
+            processCombPair<true, combTuning3, combTuning4>(spec.comb3, state.comb3, spec.comb4, state.comb4, x, acc, n);
+            processCombPair<true, combTuning5, combTuning6>(spec.comb5, state.comb5, spec.comb6, state.comb6, x, acc, n);
+            processCombPair<true, combTuning7, combTuning8>(spec.comb7, state.comb7, spec.comb8, state.comb8, x, acc, n);
+
+            for (size_t i = 0; i < n; ++i)
+                acc[i] *= 0.125f; // normalize due to x8 combs added together 1/8
+
+            AllPassFilter<allPassTuning1>::process(spec.allPass1, state.allPass1, acc, acc, n);
+            AllPassFilter<allPassTuning2>::process(spec.allPass2, state.allPass2, acc, acc, n);
+            AllPassFilter<allPassTuning3>::process(spec.allPass3, state.allPass3, acc, acc, n);
+            AllPassFilter<allPassTuning4>::process(spec.allPass4, state.allPass4, acc, out + offset, n);
         }
     }
 
+    /**
+     * @brief Cheaper process() running every other comb and all-pass filter.
+     *
+     * The output is scaled to keep the same tail level. The skipped
+     * filters are not updated, clear them with resetLowSkipped() before
+     * switching back to process().
+     */
+    static void processLow(const Spec& spec, State& state, const float* in, float* out, size_t size)
+    {
+        alignas(16) float acc[ChunkSize];
+
+        for (size_t offset = 0; offset < size; offset += ChunkSize) {
+            const size_t n = std::min(ChunkSize, size - offset);
+            const float* x = in + offset;
+
+            processCombPair<false, combTuning1, combTuning3>(spec.comb1, state.comb1, spec.comb3, state.comb3, x, acc, n);
+            processCombPair<true, combTuning5, combTuning7>(spec.comb5, state.comb5, spec.comb7, state.comb7, x, acc, n);
+
+            // Same power as process(): 8 uncorrelated combs x 1/8 and
+            // two more all-pass stages, each with a 7/3 power gain.
+            for (size_t i = 0; i < n; ++i)
+                acc[i] *= 0.125f * 1.41421356f * (7.0f / 3.0f);
+
+            AllPassFilter<allPassTuning1>::process(spec.allPass1, state.allPass1, acc, acc, n);
+            AllPassFilter<allPassTuning3>::process(spec.allPass3, state.allPass3, acc, out + offset, n);
+        }
+    }
+
+    /// Clear the filters skipped by processLow().
+    static void resetLowSkipped(const Spec& spec, State& state)
+    {
+        CombFilter<combTuning2>::resetState(spec.comb2, state.comb2);
+        CombFilter<combTuning4>::resetState(spec.comb4, state.comb4);
+        CombFilter<combTuning6>::resetState(spec.comb6, state.comb6);
+        CombFilter<combTuning8>::resetState(spec.comb8, state.comb8);
+
+        AllPassFilter<allPassTuning2>::resetState(spec.allPass2, state.allPass2);
+        AllPassFilter<allPassTuning4>::resetState(spec.allPass4, state.allPass4);
+    }
+
+};
+
+//==============================================================================
+
+/**
+ * @brief Stereo reverb filter, Reverb<> on each channel.
+ *
+ * The right channel filters are longer by SpreadOffset. Both channels
+ * run in the same loops, with shared comb and all-pass specs. The state
+ * holds the whole left reverb state followed by the whole right one, so
+ * each loop works on two filters that are apart in memory. The output
+ * of each channel is the same as the one of its mono Reverb<>.
+ */
+template <int SpreadOffset>
+struct StereoReverb
+{
+    using Left = Reverb<0>;
+    using Right = Reverb<SpreadOffset>;
+
+    static constexpr size_t ChunkSize = Left::ChunkSize;
+
+    struct Spec
+    {
+        float roomsize;
+        float damp;
+
+        typename CombFilter<Left::combTuning1>::Spec comb;
+        typename AllPassFilter<Left::allPassTuning1>::Spec allPass;
+    };
+
+    /// The state of each channel is the one of its mono reverb.
+    struct State
+    {
+        typename Left::State left;
+        typename Right::State right;
+    };
+
+    static void updateSpec(Spec& spec)
+    {
+        spec.comb.feedback = spec.roomsize;
+        spec.comb.damp = spec.damp;
+        spec.allPass.feedback = 0.5f;
+    }
+
+    static void resetState(const Spec&, State& state)
+    {
+        Left::resetState({}, state.left);
+        Right::resetState({}, state.right);
+    }
+
+    /**
+     * @brief Filter a stereo block, in place if in == out.
+     *
+     * Same output as Left::process() and Right::process().
+     */
+    static void process(const Spec& spec, State& state,
+                        const float* inL, const float* inR, float* outL, float* outR, size_t size)
+    {
+        alignas(16) float accL[ChunkSize];
+        alignas(16) float accR[ChunkSize];
+
+        auto& l = state.left;
+        auto& r = state.right;
+
+        for (size_t offset = 0; offset < size; offset += ChunkSize) {
+            const size_t n = std::min(ChunkSize, size - offset);
+            const float* xL = inL + offset;
+            const float* xR = inR + offset;
+
+            processCombPairStereo<false, Left::combTuning1, Left::combTuning2, Right::combTuning1, Right::combTuning2>(
+                spec.comb, l.comb1, l.comb2, r.comb1, r.comb2, xL, xR, accL, accR, n);
+            processCombPairStereo<true, Left::combTuning3, Left::combTuning4, Right::combTuning3, Right::combTuning4>(
+                spec.comb, l.comb3, l.comb4, r.comb3, r.comb4, xL, xR, accL, accR, n);
+            processCombPairStereo<true, Left::combTuning5, Left::combTuning6, Right::combTuning5, Right::combTuning6>(
+                spec.comb, l.comb5, l.comb6, r.comb5, r.comb6, xL, xR, accL, accR, n);
+            processCombPairStereo<true, Left::combTuning7, Left::combTuning8, Right::combTuning7, Right::combTuning8>(
+                spec.comb, l.comb7, l.comb8, r.comb7, r.comb8, xL, xR, accL, accR, n);
+
+            for (size_t i = 0; i < n; ++i) {
+                accL[i] *= 0.125f; // normalize due to x8 combs added together 1/8
+                accR[i] *= 0.125f;
+            }
+
+            processAllPassStereo<Left::allPassTuning1, Right::allPassTuning1>(
+                spec.allPass, l.allPass1, r.allPass1, accL, accR, accL, accR, n);
+            processAllPassStereo<Left::allPassTuning2, Right::allPassTuning2>(
+                spec.allPass, l.allPass2, r.allPass2, accL, accR, accL, accR, n);
+            processAllPassStereo<Left::allPassTuning3, Right::allPassTuning3>(
+                spec.allPass, l.allPass3, r.allPass3, accL, accR, accL, accR, n);
+            processAllPassStereo<Left::allPassTuning4, Right::allPassTuning4>(
+                spec.allPass, l.allPass4, r.allPass4, accL, accR, outL + offset, outR + offset, n);
+        }
+    }
+
+    /// Stereo Reverb<>::processLow().
+    static void processLow(const Spec& spec, State& state,
+                           const float* inL, const float* inR, float* outL, float* outR, size_t size)
+    {
+        alignas(16) float accL[ChunkSize];
+        alignas(16) float accR[ChunkSize];
+
+        auto& l = state.left;
+        auto& r = state.right;
+
+        for (size_t offset = 0; offset < size; offset += ChunkSize) {
+            const size_t n = std::min(ChunkSize, size - offset);
+            const float* xL = inL + offset;
+            const float* xR = inR + offset;
+
+            processCombPairStereo<false, Left::combTuning1, Left::combTuning3, Right::combTuning1, Right::combTuning3>(
+                spec.comb, l.comb1, l.comb3, r.comb1, r.comb3, xL, xR, accL, accR, n);
+            processCombPairStereo<true, Left::combTuning5, Left::combTuning7, Right::combTuning5, Right::combTuning7>(
+                spec.comb, l.comb5, l.comb7, r.comb5, r.comb7, xL, xR, accL, accR, n);
+
+            for (size_t i = 0; i < n; ++i) {
+                accL[i] *= 0.125f * 1.41421356f * (7.0f / 3.0f);
+                accR[i] *= 0.125f * 1.41421356f * (7.0f / 3.0f);
+            }
+
+            processAllPassStereo<Left::allPassTuning1, Right::allPassTuning1>(
+                spec.allPass, l.allPass1, r.allPass1, accL, accR, accL, accR, n);
+            processAllPassStereo<Left::allPassTuning3, Right::allPassTuning3>(
+                spec.allPass, l.allPass3, r.allPass3, accL, accR, outL + offset, outR + offset, n);
+        }
+    }
+
+    /// Clear the filters skipped by processLow().
+    static void resetLowSkipped(const Spec&, State& state)
+    {
+        Left::resetLowSkipped({}, state.left);
+        Right::resetLowSkipped({}, state.right);
+    }
 };
 
 } // namespace dsp
\ No newline at end of file
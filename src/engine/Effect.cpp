@@ -1,38 +1,71 @@
+#include <algorithm>
 #include "engine/Effect.h"
+#include "engine/Profiler.h"
 
 Effect::Effect(size_t numParams)
     : params(numParams)
 {
 }
 
+void Effect::processDry(const ParameterRamp& dry, const float* inL, const float* inR,
+                        float* outL, float* outR, size_t numFrames)
+{
+    for (size_t i = 0; i < numFrames; ++i) {
+        outL[i] = inL[i] * dry[i];
+        outR[i] = inR[i] * dry[i];
+    }
+}
+
 //==============================================================================
 
 EffectChain::EffectChain()
+    : m_effects {}
+    , m_numEffects(0)
 {
 }
 
-void EffectChain::append(Effect* fx)
+bool EffectChain::append(Effect* fx)
+{
+    if (m_numEffects == MAX_EFFECTS)
+        return false;
+
+    m_effects[m_numEffects++] = fx;
+    return true;
+}
+
+uint32_t EffectChain::sleepingEffects() const noexcept
 {
-    m_effects.push_back(fx);
+    uint32_t mask = 0;
+
+    for (size_t i = 0; i < m_numEffects; ++i) {
+        if (m_effects[i]->isSleeping())
+            mask |= 1u << i;
+    }
+
+    return mask;
 }
 
 void EffectChain::process(const float* inL, const float* inR,
                           float* outL, float* outR, size_t numFrames)
 {
-    if (m_effects.size() == 0) {
+    for (size_t i = 0; i < m_numEffects; ++i)
+        m_effects[i]->parameters().update(numFrames);
+
+    if (m_numEffects == 0) {
         /* Empty chain */
         if (inL != outL)
             ::memcpy(outL, inL, sizeof(float) * numFrames);
         if (inR != outR)
             ::memcpy(outR, inR, sizeof(float) * numFrames);        
-    } else if (m_effects.size() == 1) {
+    } else if (m_numEffects == 1) {
         /* Single effect */
+        PROFILE_SCOPE(perf::Profiler::Effect);
         m_effects.front()->process(inL, inR, outL, outR, numFrames);
     } else {
         const float* inBufL = inL;
         const float* inBufR = inR;
 
-        const bool evenNumberOfEffects = (0 == m_effects.size() % 2);
+        const bool evenNumberOfEffects = (0 == m_numEffects % 2);
 
         float* outBufL = outL;
         float* outBufR = outR;
@@ -45,13 +78,21 @@ void EffectChain::process(const float* inL, const float* inR,
         }
 
         auto it = m_effects.begin();
-        (*it)->process (inBufL, inBufR, outBufL, outBufR, numFrames);
+
+        {
+            PROFILE_SCOPE(perf::Profiler::Effect);
+            (*it)->process (inBufL, inBufR, outBufL, outBufR, numFrames);
+        }
+
         ++it;
 
         // This will end up with final effect outputing to the target buffer
-        while (it != m_effects.end())
+        while (it != m_effects.begin() + m_numEffects)
         {
-            (*it)->process (outBufL, outBufR, outNextBufL, outNextBufR, numFrames);
+            {
+                PROFILE_SCOPE(perf::Profiler::Effect + std::min(int(it - m_effects.begin()), perf::Profiler::MaxEffects - 1));
+                (*it)->process (outBufL, outBufR, outNextBufL, outNextBufR, numFrames);
+            }
 
             std::swap (outBufL, outNextBufL);
             std::swap (outBufR, outNextBufR);
@@ -63,6 +104,6 @@ void EffectChain::process(const float* inL, const float* inR,
 
 void EffectChain::reset()
 {
-    for (auto* fx : m_effects)
-        fx->reset();
+    for (size_t i = 0; i < m_numEffects; ++i)
+        m_effects[i]->reset();
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include <array>
 #include "engine/Globals.h"
 #include "engine/Parameter.h"
+#include "engine/TailDetector.h"
 
 class Effect
 {
@@ -13,13 +14,23 @@ public:
     virtual void process(const float* inL, const float* inR,
                          float* outL, float* outR, size_t numFrames) = 0;
 
+    /// Clear the effect state (delay lines, filters).
     virtual void reset() {}
 
+    /// Parameters, advanced by the effect chain before every block.
     ParameterPool& parameters() { return params; }
 
+    /// Whether the effect bypasses its processing until the input is not silent.
+    bool isSleeping() const noexcept { return tail.isSleeping(); }
+
 protected:
 
+    /// Output of a sleeping effect, the input at the dry gain.
+    static void processDry(const ParameterRamp& dry, const float* inL, const float* inR,
+                           float* outL, float* outR, size_t numFrames);
+
     ParameterPool params;
+    TailDetector tail;
 };
 
 //==============================================================================
@@ -27,9 +38,18 @@ protected:
 class EffectChain
 {
 public:
+
+    constexpr static size_t MAX_EFFECTS = 8;
+
     EffectChain();
 
-    void append(Effect* fx);
+    /// Returns false if the chain is full.
+    bool append(Effect* fx);
+
+    size_t size() const noexcept { return m_numEffects; }
+
+    /// Bit i is set while effect i sleeps, see Effect::isSleeping().
+    uint32_t sleepingEffects() const noexcept;
 
     void process(const float* inL, const float* inR,
                  float* outL, float* outR, size_t numFrames);
@@ -37,7 +57,8 @@ public:
     void reset();
 
 private:
-    std::vector<Effect*> m_effects;
-    std::array<float, globals::AUDIO_BLOCK_SIZE> m_mixBufL;
-    std::array<float, globals::AUDIO_BLOCK_SIZE> m_mixBufR;
+    std::array<Effect*, MAX_EFFECTS> m_effects;
+    size_t m_numEffects;
+    std::array<float, globals::MAX_BLOCK_SIZE> m_mixBufL;
+    std::array<float, globals::MAX_BLOCK_SIZE> m_mixBufR;
 };
@@ -1,7 +1,10 @@
+#include <algorithm>
 #include "engine/Engine.h"
+#include "engine/Profiler.h"
 
 Engine::Engine()
-{    
+{
+    m_qualityGovernor.setMaxLevel(m_instrument.MAX_QUALITY_LEVEL);
 }
 
 Engine::~Engine() = default;
@@ -11,50 +14,125 @@ int Engine::numActiveVoices() const noexcept
     return m_instrument.numActiveVoices();
 }
 
-void Engine::noteOn(int channel, int note, int velocity)
+uint32_t Engine::numSkippedOperatorBlocks() const noexcept
 {
-    AudioLock lock;
-    auto* msg = m_midiQueue.allocate();
-    *msg = MidiMessage::noteOn(note, velocity);
-    m_midiQueue.push(msg);
+    return FmVoice::skippedOperatorBlocks();
+}
+
+uint32_t Engine::sleepingEffects() const noexcept
+{
+    return m_instrument.effects().sleepingEffects();
+}
+
+uint32_t Engine::numMidiOverflows() const noexcept
+{
+    return m_midiQueue.numOverflows();
+}
+
+void Engine::setMidiOverflowPolicy(MidiOverflow policy)
+{
+    m_midiQueue.setOverflowPolicy(policy);
 }
 
-void Engine::noteOff(int channel, int note, int velocity)
+void Engine::updateQuality(float loadPercent)
+{
+    if (m_qualityGovernor.update(loadPercent))
+        m_instrument.setQuality(m_qualityGovernor.level());
+}
+
+void Engine::setQualityGovernor(const QualityGovernor::Settings& settings)
 {
     AudioLock lock;
-    auto* msg = m_midiQueue.allocate();
-    *msg = MidiMessage::noteOff(note, velocity);
-    m_midiQueue.push(msg);
+    m_qualityGovernor.setSettings(settings);
+}
+
+void Engine::noteOn(int channel, int note, int velocity, uint32_t timestamp)
+{
+    m_midiQueue.push(MidiMessage::noteOn(note, velocity), timestamp);
 }
 
-void Engine::controlChange(int channel, int control, int value)
+void Engine::noteOff(int channel, int note, int velocity, uint32_t timestamp)
+{
+    m_midiQueue.push(MidiMessage::noteOff(note, velocity), timestamp);
+}
+
+void Engine::controlChange(int channel, int control, int value, uint32_t timestamp)
+{
+    m_midiQueue.push(MidiMessage::controlChange(control, value), timestamp);
+}
+
+void Engine::setBlockSize(size_t numFrames)
 {
     AudioLock lock;
-    auto* msg = m_midiQueue.allocate();
-    *msg = MidiMessage::controlChange(control, value);
-    m_midiQueue.push(msg);
+    m_blockSize = math::clamp(size_t(1), globals::MAX_BLOCK_SIZE, numFrames);
+}
+
+void Engine::process(float* outL, float* outR, size_t numFrames, uint32_t blockTime)
+{
+    // Rendered in internal blocks, each one taking its share
+    // of the time since the previous call for the MIDI timing.
+    const uint32_t startTime = m_blockTime;
+    const uint32_t period = blockTime - startTime;
+
+    size_t offset = 0;
+
+    while (offset < numFrames) {
+        const size_t n = std::min(m_blockSize, numFrames - offset);
+        const uint32_t time = startTime + uint32_t(uint64_t(period) * (offset + n) / numFrames);
+
+        processBlock(outL + offset, outR + offset, n, time);
+        offset += n;
+    }
 }
 
-void Engine::process(float* outL, float* outR, size_t numFrames)
+void Engine::processBlock(float* outL, float* outR, size_t numFrames, uint32_t blockTime)
 {
-    processMidi();
+    const size_t numEvents = processMidi(numFrames, blockTime);
 
     ::memset(outL, 0, sizeof(float) * numFrames);
     ::memset(outR, 0, sizeof(float) * numFrames);
 
-    m_instrument.process(outL, outR, numFrames);
+    m_instrument.process(outL, outR, numFrames, m_midiEvents.data(), numEvents);
 }
 
-void Engine::processMidi()
+size_t Engine::processMidi(size_t numFrames, uint32_t blockTime)
 {
-    while (auto* midiMessage = m_midiQueue.next())
-    {
-        processMidiMessage(*midiMessage);
-        m_midiQueue.recycle(midiMessage);
+    PROFILE_SCOPE(perf::Profiler::Midi);
+
+    // Messages received during the previous block period are placed
+    // at the same relative position within this block.
+    const uint32_t previousBlockTime = m_blockTime;
+    const uint32_t period = blockTime - previousBlockTime;
+    const float scale = period > 0 ? float(numFrames) / float(period) : 0.0f;
+    const uint32_t lastFrame = uint32_t(numFrames - 1);
+
+    m_blockTime = blockTime;
+
+    uint32_t offset = 0;
+    size_t numEvents = 0;
+
+    // Whatever does not fit is left for the next block.
+    while (numEvents < m_midiEvents.size()) {
+        if (! m_hasHeldMessage) {
+            if (! m_midiQueue.pop(m_heldMessage, m_heldTimestamp))
+                break;
+
+            m_hasHeldMessage = true;
+        }
+
+        // Messages stamped past this block wait for the next one.
+        if (int32_t(m_heldTimestamp - blockTime) >= 0)
+            break;
+
+        const int32_t dt = int32_t(m_heldTimestamp - previousBlockTime);
+
+        // Keep the events sorted, late ones go at the current offset.
+        if (dt > 0)
+            offset = std::max(offset, std::min(uint32_t(float(dt) * scale), lastFrame));
+
+        m_midiEvents[numEvents++] = { m_heldMessage, offset };
+        m_hasHeldMessage = false;
     }
-}
 
-void Engine::processMidiMessage(const MidiMessage& msg)
-{    
-    m_instrument.processMidiMessage(msg);
-}
\ No newline at end of file
+    return numEvents;
+}
@@ -2,20 +2,38 @@
 
 #include "engine/Globals.h"
 #include "engine/MidiMessage.h"
+#include "engine/CycleCounter.h"
+#include "engine/QualityGovernor.h"
 
 #include "engine/FmSynth.h"
 
+#if defined(ENGINE_FM_VOICE_BANK)
+#   include "engine/FmVoiceBank.h"
+#endif
+
 /**
  * Audio engine control class.
  */
 class Engine final
 {
 public:
-    // Helper structure to enable/disable audio interrupt
+    // Helper structure to enable/disable audio interrupts
     struct AudioLock
     {
-        static inline void enable()  { NVIC_ENABLE_IRQ(IRQ_SOFTWARE); }
-        static inline void disable() { NVIC_DISABLE_IRQ(IRQ_SOFTWARE); }
+        // Lower priority interrupt of the render-ahead mode, see AudioProcess.
+        constexpr static int RENDER_AHEAD_IRQ = IRQ_Reserved2;
+
+        static inline void enable()
+        {
+            NVIC_ENABLE_IRQ(IRQ_SOFTWARE);
+            NVIC_ENABLE_IRQ(RENDER_AHEAD_IRQ);
+        }
+
+        static inline void disable()
+        {
+            NVIC_DISABLE_IRQ(RENDER_AHEAD_IRQ);
+            NVIC_DISABLE_IRQ(IRQ_SOFTWARE);
+        }
 
         AudioLock()  { AudioLock::disable(); }
         ~AudioLock() { AudioLock::enable();  }
@@ -26,19 +44,90 @@ public:
 
     int numActiveVoices() const noexcept;
 
-    void noteOn(int channel, int note, int velocity);
-    void noteOff(int channel, int node, int velocity);
-    void controlChange(int channel, int control, int value);
+    /// FM operator blocks skipped as silent, see FmVoice::process().
+    uint32_t numSkippedOperatorBlocks() const noexcept;
+
+    /// Bit i is set while effect i of the chain sleeps, see TailDetector.
+    uint32_t sleepingEffects() const noexcept;
+
+    /// MIDI messages dropped or coalesced due to the queue overflow.
+    uint32_t numMidiOverflows() const noexcept;
+
+    void setMidiOverflowPolicy(MidiOverflow policy);
+
+    /**
+     * @brief Account for the DSP load of the last block.
+     *
+     * Lowers the rendering quality when the load gets too high
+     * and restores it when the load falls, see QualityGovernor.
+     * Called from the audio interrupt after every block.
+     */
+    void updateQuality(float loadPercent);
+
+    /// Current quality reduction, 0 for the full quality.
+    int qualityLevel() const noexcept { return m_qualityGovernor.level(); }
+
+    void setQualityGovernor(const QualityGovernor::Settings& settings);
 
-    void process(float* outL, float* outR, size_t numFrames);
+    /// Current time for the MIDI messages and blocks time stamps.
+    static uint32_t timestamp() { return uint32_t(perf::CycleCounter::now()); }
+
+    // Can be called from outside the audio interrupt without locking it,
+    // see MidiQueue.
+    void noteOn(int channel, int note, int velocity, uint32_t timestamp = Engine::timestamp());
+    void noteOff(int channel, int node, int velocity, uint32_t timestamp = Engine::timestamp());
+    void controlChange(int channel, int control, int value, uint32_t timestamp = Engine::timestamp());
+
+    /**
+     * @brief Set the internal block size (up to globals::MAX_BLOCK_SIZE).
+     *
+     * process() renders any number of frames in blocks of this size:
+     * the voices, effects and parameters are processed once per block,
+     * so smaller blocks cost more per sample. Defaults to
+     * globals::ENGINE_BLOCK_SIZE.
+     */
+    void setBlockSize(size_t numFrames);
+    size_t blockSize() const noexcept { return m_blockSize; }
+
+    /**
+     * @brief Render a block of audio.
+     *
+     * MIDI messages time stamped between the previous call and this
+     * one are applied at the same relative position within the block,
+     * i.e. with a constant latency of one block instead of being
+     * quantized to the block boundary. The block time must use the
+     * same time base as the messages.
+     */
+    void process(float* outL, float* outR, size_t numFrames, uint32_t blockTime = Engine::timestamp());
 
 private:
 
-    void processMidi();
-    void processMidiMessage(const MidiMessage& msg);
+    // Render one internal block.
+    void processBlock(float* outL, float* outR, size_t numFrames, uint32_t blockTime);
+
+    // Collects the pending MIDI messages with their frame offsets.
+    size_t processMidi(size_t numFrames, uint32_t blockTime);
+
+    using Midi = MidiQueue<64>;
+
+    Midi m_midiQueue;
+
+    // Events of the current block, the queue plus the coalesced controllers.
+    std::array<MidiEvent, Midi::SIZE + Midi::NUM_CONTROLLERS> m_midiEvents;
+    uint32_t m_blockTime = 0;
+    size_t m_blockSize = globals::ENGINE_BLOCK_SIZE;
+
+    // Message taken from the queue but due in a later block.
+    MidiMessage m_heldMessage;
+    uint32_t m_heldTimestamp = 0;
+    bool m_hasHeldMessage = false;
 
-    MidiQueue<64> m_midiQueue;
+    QualityGovernor m_qualityGovernor;
 
+#if defined(ENGINE_FM_VOICE_BANK)
+    FmBankInstrument m_instrument;
+#else
     FmInstrument m_instrument;
+#endif
 
 };
\ No newline at end of file
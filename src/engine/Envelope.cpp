@@ -20,6 +20,9 @@ Envelope::Envelope()
     , releaseCoef (0.0f)
     , releaseBase (0.0f)
     , sustainLevel (0.0f)
+    , attackBlock {1.0f, 0.0f}
+    , decayBlock {1.0f, 0.0f}
+    , releaseBlock {1.0f, 0.0f}
 {
 }
 
@@ -45,6 +48,10 @@ void Envelope::prepare(const Envelope::Trigger& trigger)
     releaseRate = trigger.release * globals::SAMPLE_RATE;
     releaseCoef = calculate2 (releaseRate, logDecayReleaseTR);
     releaseBase = -DecayReleaseTargetRatio * (1.0f - releaseCoef);
+
+    attackBlock = controlBlock(attackCoef, attackBase);
+    decayBlock = controlBlock(decayCoef, decayBase);
+    releaseBlock = controlBlock(releaseCoef, releaseBase);
 }
 
 void Envelope::trigger()
@@ -63,10 +70,17 @@ void Envelope::release(float t)
     releaseRate = t * globals::SAMPLE_RATE;
     releaseCoef = calculate2 (releaseRate, logDecayReleaseTR);
     releaseBase = -DecayReleaseTargetRatio * (1.0f - releaseCoef);
+    releaseBlock = controlBlock(releaseCoef, releaseBase);
 
     currentState = Release;
 }
 
+void Envelope::stop()
+{
+    currentState = Off;
+    currentLevel = 0.0f;
+}
+
 float Envelope::next()
 {
     switch (currentState)
@@ -110,6 +124,95 @@ float Envelope::next()
     return currentLevel;
 }
 
+void Envelope::process(float* out, size_t numFrames)
+{
+    size_t i = 0;
+
+    while (i < numFrames) {
+        const size_t n = numFrames - i;
+
+        if (currentState == Off || currentState == Sustain) {
+            for (; i < numFrames; ++i)
+                out[i] = currentLevel;
+
+            return;
+        }
+
+        if (n >= ControlBlockSize) {
+            const Segment block = currentState == Attack ? attackBlock
+                                : currentState == Decay  ? decayBlock
+                                : releaseBlock;
+
+            const float end = block.base + currentLevel * block.coef;
+
+            if (! crossed(end)) {
+                const float start = currentLevel;
+                const float step = (end - start) * (1.0f / float(ControlBlockSize));
+
+                for (size_t k = 1; k < ControlBlockSize; ++k)
+                    out[i++] = start + float(k) * step;
+
+                out[i++] = end;
+                currentLevel = end;
+                continue;
+            }
+        }
+
+        // Transition within this control block, or a partial block.
+        const size_t m = n < ControlBlockSize ? n : ControlBlockSize;
+
+        for (size_t k = 0; k < m; ++k)
+            out[i++] = next();
+    }
+}
+
+bool Envelope::crossed(float level) const noexcept
+{
+    switch (currentState)
+    {
+    case Attack:
+        return level >= 1.0f;
+    case Decay:
+        return level <= sustainLevel;
+    case Release:
+        return level <= 0.0f;
+    default:
+        break;
+    }
+
+    return false;
+}
+
+Envelope::Segment Envelope::controlBlock(float coef, float base)
+{
+    // level -> base + level * coef composed ControlBlockSize times
+    Segment block = { 1.0f, 0.0f };
+
+    for (size_t i = 0; i < ControlBlockSize; ++i) {
+        block.coef *= coef;
+        block.base = base + block.base * coef;
+    }
+
+    return block;
+}
+
+Envelope::Segment Envelope::segment(State state) const noexcept
+{
+    switch (state)
+    {
+    case Attack:
+        return { attackCoef, attackBase };
+    case Decay:
+        return { decayCoef, decayBase };
+    case Release:
+        return { releaseCoef, releaseBase };
+    default:
+        break;
+    }
+
+    return { 1.0f, 0.0f };
+}
+
 float Envelope::calculate(float rate, float targetRatio)
 {
     return rate <= 0 ? 0.0f : expf(-logf((1.0f + targetRatio) / targetRatio) / rate);
@@ -19,6 +19,9 @@ public:
     constexpr static float AttackTargetRatio = 0.3f;
     constexpr static float DecayReleaseTargetRatio = 0.0001f;
 
+    /// Samples per control-rate step of process()
+    constexpr static size_t ControlBlockSize = 16;
+
     struct Trigger
     {
         float attack      = 0.0f;
@@ -27,6 +30,13 @@ public:
         float release     = 1.0f;
     };
 
+    /// Segment recurrence, level = base + level * coef.
+    struct Segment
+    {
+        float coef;
+        float base;
+    };
+
     Envelope();
 
     State state() const noexcept { return currentState; }
@@ -37,9 +47,28 @@ public:
     void release();
     void release(float t);
 
+    /// Switch off immediately.
+    void stop();
+
     float next();
 
+    /**
+     * @brief Fills out with the levels of the next numFrames samples,
+     *        same as numFrames calls to next().
+     *
+     * Evaluated at control rate: the exact level at the end of each
+     * ControlBlockSize samples is computed in closed form and the
+     * samples in between are ramped linearly. A control block with
+     * a state transition is evaluated per sample, so that the transition
+     * lands on the right sample.
+     */
+    void process(float* out, size_t numFrames);
+
     float level() const noexcept { return currentLevel; }
+    float sustain() const noexcept { return sustainLevel; }
+
+    /// Prepared recurrence of a state, Off and Sustain hold the level.
+    Segment segment(State state) const noexcept;
 
 private:
 
@@ -49,6 +78,11 @@ private:
     static float calculate(float rate, float targetRatio);
     static float calculate2(float rate, float logtr);
 
+    // Segment applied ControlBlockSize times
+    static Segment controlBlock(float coef, float base);
+
+    bool crossed(float level) const noexcept;
+
     State currentState;
     float currentLevel;
 
@@ -65,4 +99,8 @@ private:
     float releaseBase;
 
     float sustainLevel;
+
+    Segment attackBlock;
+    Segment decayBlock;
+    Segment releaseBlock;
 };
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include "engine/FX_Delay.h"
 
 namespace fx {
@@ -29,19 +30,40 @@ void Delay::init()
 
 void Delay::process(const float *inL, const float *inR, float *outL, float *outR, size_t numFrames)
 {
+    const auto dry = params[DRY].ramp();
+    const auto wet = params[WET].ramp();
+    const auto delay = params[DELAY].ramp();
+    const auto fb = params[FEEDBACK].ramp();
+
+    if (tail.skip(inL, inR, numFrames)) {
+        processDry(dry, inL, inR, outL, outR, numFrames);
+        return;
+    }
+
+    float tailPeak = 0.0f;
+
     for (size_t i = 0; i < numFrames; ++i) {
-        const auto dry = params[DRY].nextValue();
-        const auto wet = params[WET].nextValue();
-        const auto delay = params[DELAY].nextValue() * delayToSampleIndex;
-        const auto fb = params[FEEDBACK].nextValue();
-        const auto l = delayL.read(delay);
-        const auto r = delayR.read(delay);
-
-        delayL.write(l * fb + inL[i]);
-        delayR.write(r * fb + inR[i]);
-        outL[i] = l * wet + inL[i] * dry;
-        outR[i] = r * wet + inR[i] * dry;
+        const auto d = delay[i] * delayToSampleIndex;
+        const auto l = delayL.read(d);
+        const auto r = delayR.read(d);
+
+        delayL.write(l * fb[i] + inL[i]);
+        delayR.write(r * fb[i] + inR[i]);
+        outL[i] = l * wet[i] + inL[i] * dry[i];
+        outR[i] = r * wet[i] + inR[i] * dry[i];
+
+        tailPeak = std::max(tailPeak, std::max(fabsf(l), fabsf(r)));
     }
+
+    // The whole line must have been read as silent.
+    if (tail.update(tailPeak, numFrames, delayL.size()))
+        reset();
+}
+
+void Delay::reset()
+{
+    delayL.reset();
+    delayR.reset();
 }
 
 } // namespace fx
@@ -28,6 +28,8 @@ public:
 
     void process(const float *inL, const float *inR, float *outL, float *outR, size_t numFrames) override;
 
+    void reset() override;
+
 private:
 
     dsp::DelayLine delayL;
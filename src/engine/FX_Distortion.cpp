@@ -18,25 +18,27 @@ Distortion::Distortion()
 
 void Distortion::process (const float *inL, const float *inR, float *outL, float *outR, size_t numFrames)
 {
-    float dry = params[DRY].value();
-    float wet = params[WET].value();
-    float gain = params[GAIN].nextValue();
+    const auto dryRamp = params[DRY].ramp();
+    const auto wetRamp = params[WET].ramp();
+    const auto gainRamp = params[GAIN].ramp();
 
-    while ((params[DRY].isSmoothing() || params[WET].isSmoothing() || params[GAIN].isSmoothing()) && numFrames > 0)
-    {
-        dry = params[DRY].nextValue();
-        wet = params[WET].nextValue();
-        gain = params[GAIN].nextValue();
+    if (! (dryRamp.isConstant() && wetRamp.isConstant() && gainRamp.isConstant())) {
+        for (size_t i = 0; i < numFrames; ++i) {
+            const float dry = dryRamp[i];
+            const float wet = wetRamp[i];
+            const float gain = gainRamp[i];
 
-        const float l = *(inL++);
-        const float r = *(inR++);
+            outL[i] = dry * inL[i] + wet * distort(math::clamp(-1.0f, 1.0f, inL[i] * gain));
+            outR[i] = dry * inR[i] + wet * distort(math::clamp(-1.0f, 1.0f, inR[i] * gain));
+        }
 
-        *(outL++) = dry * l + wet * distort(math::clamp(-1.0f, 1.0f, l * gain));
-        *(outR++) = dry * r + wet * distort(math::clamp(-1.0f, 1.0f, r * gain));
-
-        --numFrames;
+        return;
     }
 
+    const float dry = params[DRY].value();
+    const float wet = params[WET].value();
+    const float gain = params[GAIN].value();
+
     while (numFrames > 0) {
         const float l = *(inL++);
         const float r = *(inR++);
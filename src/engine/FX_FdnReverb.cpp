@@ -0,0 +1,380 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "engine/Arena.h"
+#include "engine/Sine.h"
+#include "engine/FX_FdnReverb.h"
+
+namespace fx {
+
+namespace {
+
+// Delay lengths in frames, mutually prime. Low and Medium run
+// the first 8 lines, even lines are left and odd ones right.
+constexpr std::array<int, FdnReverb::MAX_LINES> lineLength {
+    601, 691, 797, 907, 1031, 1163, 1301, 1453,
+    557, 647, 743, 853, 967, 1097, 1229, 1381
+};
+
+// Sign of the input into each line. Feeding all the lines with the same sign
+// lines up the input with the mixing matrices, which then recirculate it
+// coherently and ring on tonal input.
+constexpr std::array<float, FdnReverb::MAX_LINES> inputSign {
+    1.0f,  1.0f, -1.0f,  1.0f,  1.0f, -1.0f, -1.0f, -1.0f,
+    1.0f, -1.0f,  1.0f,  1.0f, -1.0f,  1.0f, -1.0f, -1.0f
+};
+
+// Length at which the decay gain equals the room size, so that the room
+// size gives about the same decay time as with fx::Reverb.
+constexpr float ReferenceLength = 1400.0f;
+
+// Delays modulation, up to this number of frames on top of the line length.
+constexpr float ModulationDepth = 8.0f;
+constexpr float ModulationRate = 0.35f;     // [Hz], slightly different on each line
+constexpr float ModulationRateSpread = 0.07f;
+
+// Frames processed at once, shorter than any line.
+constexpr size_t ChunkSize = 32;
+
+// The delay lines have room for the modulation and the interpolation.
+constexpr int LineHeadroom = int(ModulationDepth) + 2;
+
+// Levels matching fx::Reverb for a white noise input, with 8 lines.
+// The output of 16 lines is scaled down by sqrt(2).
+constexpr float InputGain = 0.5f;
+constexpr float OutputGain = 1.85f;
+
+/// Fast Walsh-Hadamard transform of each frame, not normalized.
+template <size_t N, size_t Size>
+inline void hadamard(float (&v)[N][Size], size_t numFrames)
+{
+    for (size_t h = 1; h < N; h *= 2) {
+        for (size_t i = 0; i < N; i += 2 * h) {
+            for (size_t j = i; j < i + h; ++j) {
+                for (size_t k = 0; k < numFrames; ++k) {
+                    const float a = v[j][k];
+                    const float b = v[j + h][k];
+                    v[j][k] = a + b;
+                    v[j + h][k] = a - b;
+                }
+            }
+        }
+    }
+}
+
+} // anonymous namespace
+
+FdnReverb::FdnReverb(Quality maxQuality)
+    : Effect(NUM_PARAMS)
+    , m_buffer {}
+    , m_size {}
+    , m_writeIndex {}
+    , m_gain {}
+    , m_filterStore {}
+    , m_delay {}
+    , m_delayStep {}
+    , m_lfoPhase {}
+    , m_roomSize(-1.0f)
+    , m_damp(DefaultDamp)
+    , m_maxQuality(maxQuality)
+    , m_quality(maxQuality)
+{
+    params[DRY].setValue (DefaultDry, 0.5f, true);
+    params[WET].setValue (DefaultWet, 0.5f, true);
+    params[ROOM_SIZE].setValue (DefaultRoomSize, 0.5f, true);
+    params[DAMP].setValue (DefaultDamp, 0.5f, true);
+    params[WIDTH].setValue (DefaultWidth, 0.5f, true);
+
+    // Fall back to 8 lines if 16 do not fit the arena.
+    for (size_t n = numLines(); n > 0 && m_buffer[0] == nullptr; n -= MAX_LINES / 2) {
+        size_t total = 0;
+
+        for (size_t i = 0; i < n; ++i)
+            total += size_t(lineLength[i] + LineHeadroom);
+
+        if (float* memory = mem::allocate<float>(mem::Region::Bulk, total)) {
+            for (size_t i = 0; i < n; ++i) {
+                m_buffer[i] = memory;
+                m_size[i] = lineLength[i] + LineHeadroom;
+                memory += m_size[i];
+            }
+        } else if (n == MAX_LINES) {
+            m_maxQuality = Quality::Medium;
+            m_quality = Quality::Medium;
+        }
+    }
+
+    for (size_t i = 0; i < MAX_LINES; ++i) {
+        m_delay[i] = float(lineLength[i]);
+        m_lfoPhase[i] = float(i) / float(MAX_LINES);
+    }
+
+    reset();
+}
+
+size_t FdnReverb::memorySize() const noexcept
+{
+    size_t bytes = 0;
+
+    for (size_t i = 0; i < MAX_LINES; ++i) {
+        if (m_buffer[i] != nullptr)
+            bytes += sizeof(float) * size_t(m_size[i]);
+    }
+
+    return bytes;
+}
+
+void FdnReverb::reset()
+{
+    resetLines(0, MAX_LINES);
+}
+
+void FdnReverb::resetLines(size_t first, size_t last)
+{
+    for (size_t i = first; i < last; ++i) {
+        if (m_buffer[i] != nullptr)
+            ::memset(m_buffer[i], 0, sizeof(float) * size_t(m_size[i]));
+
+        m_writeIndex[i] = 0;
+        m_filterStore[i] = 0.0f;
+    }
+}
+
+void FdnReverb::setQuality(Quality q)
+{
+    // Quality enumerators go down from High.
+    q = std::max(q, m_maxQuality);
+
+    if (q == m_quality)
+        return;
+
+    // The lines of the high quality still hold the tail from before,
+    // they must start silent once back to high quality.
+    if (m_quality == Quality::High)
+        resetLines(MAX_LINES / 2, MAX_LINES);
+
+    m_quality = q;
+
+    // Decay gains depend on the matrix.
+    m_roomSize = -1.0f;
+}
+
+const float* FdnReverb::readLine(size_t line, int delay, float* scratch, size_t numFrames) const
+{
+    const float* buffer = m_buffer[line];
+    const int size = m_size[line];
+
+    int r = m_writeIndex[line] - delay;
+    r += r < 0 ? size : 0;
+
+    if (r + int(numFrames) <= size)
+        return buffer + r;
+
+    // Up to the end of the buffer, then from its start
+    const size_t first = size_t(size - r);
+    std::copy(buffer + r, buffer + size, scratch);
+    std::copy(buffer, buffer + (numFrames - first), scratch + first);
+
+    return scratch;
+}
+
+void FdnReverb::writeLine(size_t line, const float* feedback, const float* feed, size_t numFrames)
+{
+    float* buffer = m_buffer[line];
+    const int size = m_size[line];
+    const int w = m_writeIndex[line];
+
+    const size_t first = std::min(numFrames, size_t(size - w));
+    float* out = buffer + w;
+
+    for (size_t k = 0; k < first; ++k)
+        out[k] = feedback[k] + feed[k];
+
+    for (size_t k = first; k < numFrames; ++k)
+        buffer[k - first] = feedback[k] + feed[k];
+
+    const int next = w + int(numFrames);
+    m_writeIndex[line] = next < size ? next : next - size;
+}
+
+void FdnReverb::updateParams(size_t numFrames)
+{
+    const float roomSize = params[ROOM_SIZE].target();
+    m_damp = params[DAMP].target();
+
+    const size_t n = numLines();
+
+    if (roomSize != m_roomSize) {
+        m_roomSize = roomSize;
+
+        // The Hadamard matrix is normalized here.
+        const float scale = m_quality == Quality::Low ? 1.0f : 1.0f / sqrtf(float(n));
+
+        for (size_t i = 0; i < n; ++i)
+            m_gain[i] = scale * powf(roomSize, float(lineLength[i]) / ReferenceLength);
+    }
+
+    if (m_quality == Quality::Low)
+        return;
+
+    const float frames = float(numFrames);
+
+    for (size_t i = 0; i < n; ++i) {
+        const float rate = ModulationRate + ModulationRateSpread * float(i) / float(MAX_LINES);
+
+        m_lfoPhase[i] += rate * frames / globals::SAMPLE_RATE;
+        m_lfoPhase[i] -= floorf(m_lfoPhase[i]);
+
+        const float target = float(lineLength[i]) + 0.5f * ModulationDepth * (1.0f + sineLUT(m_lfoPhase[i]));
+        m_delayStep[i] = (target - m_delay[i]) / frames;
+    }
+}
+
+template <size_t NumLines, bool Modulated, bool Hadamard>
+void FdnReverb::processLines(const float* inL, const float* inR, float* outL, float* outR, size_t numFrames)
+{
+    constexpr size_t N = NumLines;
+
+    const float damp1 = m_damp;
+    const float damp2 = 1.0f - m_damp;
+
+    // The lines are longer than a chunk: the whole chunk is read from the lines
+    // before any of it is written back, and each step runs over the chunk.
+    for (size_t offset = 0; offset < numFrames; offset += ChunkSize) {
+        const size_t n = std::min(ChunkSize, numFrames - offset);
+
+        float* chunkL = outL + offset;
+        float* chunkR = outR + offset;
+
+        float v[N][ChunkSize];
+        float sum[ChunkSize];
+
+        std::fill(chunkL, chunkL + n, 0.0f);
+        std::fill(chunkR, chunkR + n, 0.0f);
+        std::fill(sum, sum + n, 0.0f);
+
+        // Two lines at a time, so that their damping filters overlap
+        for (size_t i = 0; i < N; i += 2) {
+            float scratch[2][ChunkSize + 1];
+            float frac[2] = { 0.0f, 0.0f };
+            const float* y[2];
+
+            for (size_t j = 0; j < 2; ++j) {
+                if (Modulated) {
+                    // The modulation moves the delay by a small fraction of a frame
+                    // over a chunk, it is taken at the middle of the chunk.
+                    const float d = m_delay[i + j] + m_delayStep[i + j] * (float(offset) + 0.5f * float(n));
+                    const int di = int(d);
+                    frac[j] = d - float(di);
+
+                    // One more frame for the interpolation, y[j][k + 1] is delayed by d
+                    y[j] = readLine(i + j, di + 1, scratch[j], n + 1);
+                } else {
+                    y[j] = readLine(i + j, lineLength[i + j], scratch[j], n);
+                }
+            }
+
+            // The filter state is kept scaled by the line gain
+            const float input0 = m_gain[i] * damp2;
+            const float input1 = m_gain[i + 1] * damp2;
+            float store0 = m_filterStore[i];
+            float store1 = m_filterStore[i + 1];
+
+            for (size_t k = 0; k < n; ++k) {
+                const float a0 = Modulated ? y[0][k + 1] + (y[0][k] - y[0][k + 1]) * frac[0] : y[0][k];
+                const float a1 = Modulated ? y[1][k + 1] + (y[1][k] - y[1][k + 1]) * frac[1] : y[1][k];
+
+                chunkL[k] += a0;
+                chunkR[k] += a1;
+
+                // Frequency dependent decay
+                store0 = a0 * input0 + store0 * damp1;
+                store1 = a1 * input1 + store1 * damp1;
+
+                v[i][k] = store0;
+                v[i + 1][k] = store1;
+
+                if (! Hadamard)
+                    sum[k] += v[i][k] + v[i + 1][k];
+            }
+
+            m_filterStore[i] = store0;
+            m_filterStore[i + 1] = store1;
+        }
+
+        // Input plus what the mixing matrix adds to every line,
+        // for the left and right lines with either input sign
+        float feed[4][ChunkSize];
+
+        if (Hadamard)
+            hadamard<N>(v, n);
+
+        for (size_t k = 0; k < n; ++k) {
+            // Householder reflection I - 2/N 11^T
+            const float c = Hadamard ? 0.0f : sum[k] * (2.0f / float(N));
+            const float xL = inL[offset + k] * InputGain;
+            const float xR = inR[offset + k] * InputGain;
+
+            feed[0][k] = xL - c;
+            feed[1][k] = xR - c;
+            feed[2][k] = -xL - c;
+            feed[3][k] = -xR - c;
+        }
+
+        for (size_t i = 0; i < N; ++i)
+            writeLine(i, v[i], feed[(i & 1) + (inputSign[i] < 0.0f ? 2 : 0)], n);
+    }
+
+    if (Modulated) {
+        for (size_t i = 0; i < N; ++i)
+            m_delay[i] += m_delayStep[i] * float(numFrames);
+    }
+}
+
+void FdnReverb::process(const float *inL, const float *inR, float *outL, float *outR, size_t numFrames)
+{
+    if (m_buffer[0] == nullptr || tail.skip(inL, inR, numFrames)) {
+        processDry(params[DRY].ramp(), inL, inR, outL, outR, numFrames);
+        return;
+    }
+
+    updateParams(numFrames);
+
+    float* tmpL = m_mixBufL.data();
+    float* tmpR = m_mixBufR.data();
+
+    switch (m_quality) {
+        case Quality::High:
+            processLines<MAX_LINES, true, true>(inL, inR, tmpL, tmpR, numFrames);
+            break;
+        case Quality::Medium:
+            processLines<MAX_LINES / 2, true, true>(inL, inR, tmpL, tmpR, numFrames);
+            break;
+        default:
+            processLines<MAX_LINES / 2, false, false>(inL, inR, tmpL, tmpR, numFrames);
+            break;
+    }
+
+    const float outputGain = m_quality == Quality::High ? OutputGain * 0.70710678f : OutputGain;
+    const float tailPeak = TailDetector::peak(tmpL, tmpR, numFrames) * outputGain;
+
+    const auto width = params[WIDTH].ramp();
+    const auto dry = params[DRY].ramp();
+    const auto wet = params[WET].ramp();
+
+    // Dry/wet mixing as in fx::Reverb, the lines output gain applied here
+    for (size_t i = 0; i < numFrames; ++i) {
+        const auto wet1 = outputGain * wet[i] * (width[i] * 0.5f + 0.5f);
+        const auto wet2 = outputGain * wet[i] * (0.5f * (1.0f - width[i]));
+
+        outL[i] = tmpL[i] * wet1 + tmpR[i] * wet2 + inL[i] * dry[i];
+        outR[i] = tmpR[i] * wet1 + tmpL[i] * wet2 + inR[i] * dry[i];
+    }
+
+    const size_t longestLine = size_t(*std::max_element(lineLength.begin(), lineLength.end()) + LineHeadroom);
+
+    if (tail.update(tailPeak, numFrames, longestLine))
+        reset();
+}
+
+} // namespace fx
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <array>
+#include "engine/Effect.h"
+
+namespace fx {
+
+/**
+ * @brief Feedback delay network reverb.
+ *
+ * Each delay line goes through a damping low-pass filter and a decay
+ * gain scaled to its length, then the lines are mixed back with an
+ * orthogonal matrix. The left input feeds the even lines and is taken
+ * from them, the right one the odd lines. The parameters and the dry/wet
+ * mixing are those of fx::Reverb (without the shimmer), so it can take
+ * its place in an effect chain.
+ *
+ * Quality tiers, with the cost per stereo frame measured by the bench on
+ * an x86 host only (fx::Reverb: 29 ns). The Cortex-M7 cycles have not been
+ * measured, the fx::FdnReverb rows of an ENGINE_BENCHMARK build give them.
+ * - Low: 8 lines, Householder matrix, fixed delays (21 ns)
+ * - Medium: 8 lines, Hadamard matrix, modulated delays (36 ns)
+ * - High: 16 lines, Hadamard matrix, modulated delays (67 ns)
+ *
+ * The delay lines come from the bulk memory arena: 31 KB for 8 lines
+ * (Low and Medium), 61 KB for 16 lines (High).
+ */
+class FdnReverb : public Effect
+{
+public:
+
+    enum Params
+    {
+        DRY = 0,
+        WET,
+        ROOM_SIZE,
+        DAMP,
+        WIDTH,
+
+        NUM_PARAMS
+    };
+
+    // Default parameters set on reverb creation
+    constexpr static float DefaultDry      = 1.0f;
+    constexpr static float DefaultWet      = 0.5f;
+    constexpr static float DefaultRoomSize = 0.7f;
+    constexpr static float DefaultDamp     = 0.2f;
+    constexpr static float DefaultWidth    = 1.0f;
+
+    enum class Quality
+    {
+        High,
+        Medium,
+        Low
+    };
+
+    constexpr static size_t MAX_LINES = 16;
+
+    /// Delay lines are allocated for the highest quality the reverb can run at.
+    explicit FdnReverb(Quality maxQuality = Quality::High);
+
+    void process(const float *inL, const float *inR, float *outL, float *outR, size_t numFrames) override;
+
+    void reset() override;
+
+    /// Quality is limited to the one given on construction.
+    void setQuality(Quality q);
+    Quality quality() const noexcept { return m_quality; }
+
+    size_t numLines() const noexcept { return m_quality == Quality::High ? MAX_LINES : MAX_LINES / 2; }
+
+    /// Delay lines memory in bytes.
+    size_t memorySize() const noexcept;
+
+private:
+
+    template <size_t NumLines, bool Modulated, bool Hadamard>
+    void processLines(const float* inL, const float* inR, float* outL, float* outR, size_t numFrames);
+
+    /// Frames of the line delayed by the given number of frames, copied to scratch if they wrap.
+    const float* readLine(size_t line, int delay, float* scratch, size_t numFrames) const;
+
+    /// Writes the feedback plus the feed and advances the line.
+    void writeLine(size_t line, const float* feedback, const float* feed, size_t numFrames);
+
+    void updateParams(size_t numFrames);
+
+    void resetLines(size_t first, size_t last);
+
+    // Structure of arrays, one entry per delay line
+    std::array<float*, MAX_LINES> m_buffer;
+    std::array<int, MAX_LINES> m_size;
+    std::array<int, MAX_LINES> m_writeIndex;
+    std::array<float, MAX_LINES> m_gain;
+    std::array<float, MAX_LINES> m_filterStore;
+    std::array<float, MAX_LINES> m_delay;       // Delay at the start of the block, in frames
+    std::array<float, MAX_LINES> m_delayStep;   // Modulation increment per frame
+    std::array<float, MAX_LINES> m_lfoPhase;
+
+    float m_roomSize;
+    float m_damp;
+
+    Quality m_maxQuality;
+    Quality m_quality;
+
+    std::array<float, globals::MAX_BLOCK_SIZE> m_mixBufL;
+    std::array<float, globals::MAX_BLOCK_SIZE> m_mixBufR;
+};
+
+} // namespace fx
@@ -1,7 +1,11 @@
+#include <algorithm>
 #include "engine/FX_LowPass.h"
 
 namespace fx {
 
+// Frames between filter coefficients updates while the parameters ramp
+constexpr size_t FilterUpdateFrames = 16;
+
 static void updateFilter (dsp::BiquadFilter::Spec& spec, float f, float q)
 {
     spec.freq = f;
@@ -34,19 +38,20 @@ void LowPass::init()
 
 void LowPass::process (const float *inL, const float *inR, float *outL, float *outR, size_t numFrames)
 {
-    float f = params[FREQUENCY].value();
-    float q = params[Q_FACTOR].value();
+    const auto f = params[FREQUENCY].ramp();
+    const auto q = params[Q_FACTOR].ramp();
 
-    while ((params[FREQUENCY].isSmoothing() || params[Q_FACTOR].isSmoothing()) && numFrames > 0)
-    {
-        f = params[FREQUENCY].nextValue();
-        q = params[Q_FACTOR].nextValue();
-        updateFilter (filterSpec, f, q);
+    if (! (f.isConstant() && q.isConstant())) {
+        // Follow the ramps updating the coefficients every few frames
+        for (size_t offset = 0; offset < numFrames; offset += FilterUpdateFrames) {
+            const size_t n = std::min (FilterUpdateFrames, numFrames - offset);
+            updateFilter (filterSpec, f[offset + n - 1], q[offset + n - 1]);
 
-        *(outL++) = dsp::BiquadFilter::tick(filterSpec, filterL, *(inL++));
-        *(outR++) = dsp::BiquadFilter::tick(filterSpec, filterR, *(inR++));
+            dsp::BiquadFilter::process(filterSpec, filterL, inL + offset, outL + offset, n);
+            dsp::BiquadFilter::process(filterSpec, filterR, inR + offset, outR + offset, n);
+        }
 
-        --numFrames;
+        return;
     }
 
     dsp::BiquadFilter::process(filterSpec, filterL, inL, outL, numFrames);
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include "engine/FX_PitchShift.h"
 
 namespace fx {
@@ -7,8 +8,8 @@ constexpr float FilterOpenFreq = 22000.0f; // [Hz]
 
 PitchShift::PitchShift()
     : Effect(NUM_PARAMS)
-    , delayL()
-    , delayR()
+    , delayL((size_t) (globals::SAMPLE_RATE * MaxDelay))
+    , delayR((size_t) (globals::SAMPLE_RATE * MaxDelay))
     , dA(0.0f)
     , dB(0.0f)
     , w(0.0f)
@@ -50,14 +51,23 @@ void PitchShift::init()
 
 void PitchShift::process(const float *inL, const float *inR, float *outL, float *outR, size_t numFrames)
 {
-    if (params[PITCH].isSmoothing())
+    const auto dry = params[DRY].ramp();
+    const auto wet = params[WET].ramp();
+    const auto pitch = params[PITCH].ramp();
+
+    if (tail.skip(inL, inR, numFrames)) {
+        processDry(dry, inL, inR, outL, outR, numFrames);
+        return;
+    }
+
+    if (! pitch.isConstant())
         updateFilter();
 
+    float tailPeak = 0.0f;
+
     for (size_t i = 0; i < numFrames; ++i)
     {
-        const auto dry = params[DRY].nextValue();
-        const auto wet = params[WET].nextValue();
-        const auto p = 1.0f - params[PITCH].nextValue();
+        const auto p = 1.0f - pitch[i];
 
         delayL.write(dsp::BiquadFilter::tick(filterSpec, filterL,
                                              dsp::DCBlocker::tick(dcBlockSpec, dcBlockL, inL[i])));
@@ -86,9 +96,26 @@ void PitchShift::process(const float *inL, const float *inR, float *outL, float
         else if (dB > delayR.size())
             dB -= delayR.size();
 
-        outL[i] = l * wet + inL[i] * dry;
-        outR[i] = r * wet + inR[i] * dry;
+        outL[i] = l * wet[i] + inL[i] * dry[i];
+        outR[i] = r * wet[i] + inR[i] * dry[i];
+
+        tailPeak = std::max(tailPeak, std::max(fabsf(l), fabsf(r)));
     }
+
+    if (tail.update(tailPeak, numFrames, delaySize()))
+        reset();
+}
+
+void PitchShift::reset()
+{
+    dsp::BiquadFilter::resetState(filterSpec, filterL);
+    dsp::BiquadFilter::resetState(filterSpec, filterR);
+
+    dsp::DCBlocker::resetState(dcBlockSpec, dcBlockL);
+    dsp::DCBlocker::resetState(dcBlockSpec, dcBlockR);
+
+    delayL.reset();
+    delayR.reset();
 }
 
 void PitchShift::updateFilter()
@@ -21,6 +21,11 @@ public:
 
     void process(const float *inL, const float *inR, float *outL, float *outR, size_t numFrames) override;
 
+    void reset() override;
+
+    /// Length of the delay lines in frames.
+    size_t delaySize() const { return delayL.size(); }
+
 private:
 
     void init();
@@ -4,6 +4,7 @@ namespace fx {
 
 Reverb::Reverb()
     : Effect(NUM_PARAMS)
+    , m_quality(Quality::High)
 {
     params[DRY].setValue (DefaultDry, 0.5f, true);
     params[WET].setValue (DefaultWet, 0.5f, true);
@@ -17,22 +18,16 @@ Reverb::Reverb()
     params[FEEDBACK].setRange (0.0f, 1.0f);
     params[FEEDBACK].setValue (DefaultFeedback, 0.5f, true);
 
-    reverbLSpec.roomsize = DefaultRoomSize;
-    reverbLSpec.damp = DefaultDamp;
-
-    reverbRSpec.roomsize = DefaultRoomSize;
-    reverbRSpec.damp = DefaultDamp;
+    reverbSpec.roomsize = DefaultRoomSize;
+    reverbSpec.damp = DefaultDamp;
 
     init();
 }
 
 void Reverb::init()
 {
-    ReverbL::updateSpec(reverbLSpec);
-    ReverbR::updateSpec(reverbRSpec);
-
-    ReverbL::resetState(reverbLSpec, reverbLState);
-    ReverbR::resetState(reverbRSpec, reverbRState);
+    StereoReverb::updateSpec(reverbSpec);
+    StereoReverb::resetState(reverbSpec, reverbState);
 
     ::memset(m_mixBufL.data(), 0, sizeof(float) * m_mixBufL.size());
     ::memset(m_mixBufR.data(), 0, sizeof(float) * m_mixBufR.size());
@@ -42,8 +37,27 @@ void Reverb::init()
     //pitchShift.parameters()[PitchShift::PITCH].setValue (params[PITCH].value(), true);
 }
 
+void Reverb::setQuality(Quality q)
+{
+    if (q == m_quality)
+        return;
+
+    // The skipped filters still hold the tail from before,
+    // they must start silent once back to high quality.
+    if (q == Quality::Low) {
+        StereoReverb::resetLowSkipped(reverbSpec, reverbState);
+    }
+
+    m_quality = q;
+}
+
 void Reverb::process (const float *inL, const float *inR, float *outL, float *outR, size_t numFrames)
 {
+    if (tail.skip(inL, inR, numFrames)) {
+        processDry(params[DRY].ramp(), inL, inR, outL, outR, numFrames);
+        return;
+    }
+
     updateParams();
 
     float* tmpL = m_mixBufL.data();
@@ -52,6 +66,8 @@ void Reverb::process (const float *inL, const float *inR, float *outL, float *ou
     const auto pitch = params[PITCH].value();
     const auto feedback = params[FEEDBACK].value();
 
+    const auto processReverb = m_quality == Quality::High ? &StereoReverb::process : &StereoReverb::processLow;
+
     if (feedback > 0.0f && pitch != 1.0f) {
         // Shimmer reverb
         pitchShift.parameters()[PitchShift::PITCH].setValue (pitch, true);
@@ -62,39 +78,49 @@ void Reverb::process (const float *inL, const float *inR, float *outL, float *ou
             tmpR[i] = inR[i] + feedback * tmpR[i];
         }        
 
-        ReverbL::process(reverbLSpec, reverbLState, tmpL, tmpL, numFrames);
-        ReverbR::process(reverbRSpec, reverbRState, tmpR, tmpR, numFrames);
+        processReverb(reverbSpec, reverbState, tmpL, tmpR, tmpL, tmpR, numFrames);
     
     } else {
         // Normal reverb
-        ReverbL::process(reverbLSpec, reverbLState, inL, tmpL, numFrames);
-        ReverbR::process(reverbRSpec, reverbRState, inR, tmpR, numFrames);
+        processReverb(reverbSpec, reverbState, inL, inR, tmpL, tmpR, numFrames);
     }
     
-    const float width = params[WIDTH].value();
-    const float dry = params[DRY].value();
-    const float wet = params[WET].value();
+    const float tailPeak = TailDetector::peak(tmpL, tmpR, numFrames);
+
+    const auto width = params[WIDTH].ramp();
+    const auto dry = params[DRY].ramp();
+    const auto wet = params[WET].ramp();
 
     // Dry/wet mixing
     for (size_t i = 0; i < numFrames; ++i) {
-        const auto wet1 = wet * (width * 0.5f + 0.5f);
-        const auto wet2 = wet * (0.5f * (1.0f - width));
+        const auto wet1 = wet[i] * (width[i] * 0.5f + 0.5f);
+        const auto wet2 = wet[i] * (0.5f * (1.0f - width[i]));
 
-        outL[i] = tmpL[i] * wet1 + tmpR[i] * wet2 + inL[i] * dry;
-        outR[i] = tmpR[i] * wet1 + tmpL[i] * wet2 + inR[i] * dry;
+        outL[i] = tmpL[i] * wet1 + tmpR[i] * wet2 + inL[i] * dry[i];
+        outR[i] = tmpR[i] * wet1 + tmpL[i] * wet2 + inR[i] * dry[i];
     }
+
+    // Longest path through the filters, plus the shimmer pitch shifter.
+    using R = StereoReverb::Right;
+    constexpr size_t filtersFrames = R::combTuning8 + R::allPassTuning1 + R::allPassTuning2
+                                   + R::allPassTuning3 + R::allPassTuning4;
+
+    if (tail.update(tailPeak, numFrames, filtersFrames + pitchShift.delaySize()))
+        reset();
 }
 
-void Reverb::updateParams()
+void Reverb::reset()
 {
-    reverbLSpec.roomsize = params[ROOM_SIZE].target();
-    reverbLSpec.damp = params[DAMP].target();
+    StereoReverb::resetState(reverbSpec, reverbState);
+    pitchShift.reset();
+}
 
-    reverbRSpec.roomsize = params[ROOM_SIZE].target();
-    reverbRSpec.damp = params[DAMP].target();
+void Reverb::updateParams()
+{
+    reverbSpec.roomsize = params[ROOM_SIZE].target();
+    reverbSpec.damp = params[DAMP].target();
 
-    ReverbL::updateSpec(reverbLSpec);
-    ReverbR::updateSpec(reverbRSpec);
+    StereoReverb::updateSpec(reverbSpec);
 }
 
 } // namespace fx
@@ -33,12 +33,24 @@ public:
     constexpr static float DefaultPitch    = 1.0f;
     constexpr static float DefaultFeedback = 0.0f;
 
+    /// Processing quality, Low runs half of the reverb filters.
+    enum class Quality
+    {
+        High,
+        Low
+    };
+
     static const char* Type;
 
     Reverb();
 
     void process(const float *inL, const float *inR, float *outL, float *outR, size_t numFrames) override;
 
+    void reset() override;
+
+    void setQuality(Quality q);
+    Quality quality() const noexcept { return m_quality; }
+
 private:
 
     void init();
@@ -47,19 +59,17 @@ private:
 
     static constexpr int stereoSpread = 23;
 
-    using ReverbL = dsp::Reverb<0>;
-    using ReverbR = dsp::Reverb<stereoSpread>;
-
-    ReverbL::Spec reverbLSpec;
-    ReverbR::Spec reverbRSpec;
+    using StereoReverb = dsp::StereoReverb<stereoSpread>;
 
-    ReverbL::State reverbLState;
-    ReverbR::State reverbRState;
+    StereoReverb::Spec reverbSpec;
+    StereoReverb::State reverbState;
 
-    std::array<float, globals::AUDIO_BLOCK_SIZE> m_mixBufL;
-    std::array<float, globals::AUDIO_BLOCK_SIZE> m_mixBufR;
+    std::array<float, globals::MAX_BLOCK_SIZE> m_mixBufL;
+    std::array<float, globals::MAX_BLOCK_SIZE> m_mixBufR;
 
     PitchShift pitchShift;
+
+    Quality m_quality;
 };
 
 } // namespace fx
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cstdint>
+
+namespace fm {
+
+constexpr int NUM_OPERATORS  = 6;
+constexpr int NUM_ALGORITHMS = 32;
+
+/**
+ * @brief FM operators routing.
+ *
+ * Operators are indexed 0..5 (operators 1..6 in DX7 terms).
+ * An operator can only be modulated by higher indexed operators,
+ * so evaluating them from 5 down to 0 always has the modulation
+ * inputs ready. The feedback target is modulated by the previous
+ * sample of the feedback source.
+ */
+struct Algorithm
+{
+    uint8_t modulators[NUM_OPERATORS];  // Bit mask of the operators modulating each operator
+    uint8_t carriers;                   // Bit mask of the operators mixed to the output
+    uint8_t feedbackSource;
+    uint8_t feedbackTarget;
+};
+
+/// Bit mask of a DX7 operator number (1..6).
+constexpr uint8_t OP(int n) { return uint8_t(1 << (n - 1)); }
+
+/**
+ * The 32 DX7 algorithms.
+ *
+ * Comments use DX7 numbering, "1<2" means operator 2 modulates operator 1.
+ */
+constexpr Algorithm ALGORITHMS[NUM_ALGORITHMS] = {
+    //  1: 1<2; 3<4; 4<5; 5<6, feedback 6>6
+    { { OP(2), 0, OP(4), OP(5), OP(6), 0 }, OP(1) | OP(3), 5, 5 },
+    //  2: 1<2; 3<4; 4<5; 5<6, feedback 2>2
+    { { OP(2), 0, OP(4), OP(5), OP(6), 0 }, OP(1) | OP(3), 1, 1 },
+    //  3: 1<2; 2<3; 4<5; 5<6, feedback 6>6
+    { { OP(2), OP(3), 0, OP(5), OP(6), 0 }, OP(1) | OP(4), 5, 5 },
+    //  4: 1<2; 2<3; 4<5; 5<6, feedback 4>6
+    { { OP(2), OP(3), 0, OP(5), OP(6), 0 }, OP(1) | OP(4), 3, 5 },
+    //  5: 1<2; 3<4; 5<6, feedback 6>6
+    { { OP(2), 0, OP(4), 0, OP(6), 0 }, OP(1) | OP(3) | OP(5), 5, 5 },
+    //  6: 1<2; 3<4; 5<6, feedback 5>6
+    { { OP(2), 0, OP(4), 0, OP(6), 0 }, OP(1) | OP(3) | OP(5), 4, 5 },
+    //  7: 1<2; 3<4; 3<5; 5<6, feedback 6>6
+    { { OP(2), 0, OP(4) | OP(5), 0, OP(6), 0 }, OP(1) | OP(3), 5, 5 },
+    //  8: 1<2; 3<4; 3<5; 5<6, feedback 4>4
+    { { OP(2), 0, OP(4) | OP(5), 0, OP(6), 0 }, OP(1) | OP(3), 3, 3 },
+    //  9: 1<2; 3<4; 3<5; 5<6, feedback 2>2
+    { { OP(2), 0, OP(4) | OP(5), 0, OP(6), 0 }, OP(1) | OP(3), 1, 1 },
+    // 10: 1<2; 2<3; 4<5; 4<6, feedback 3>3
+    { { OP(2), OP(3), 0, OP(5) | OP(6), 0, 0 }, OP(1) | OP(4), 2, 2 },
+    // 11: 1<2; 2<3; 4<5; 4<6, feedback 6>6
+    { { OP(2), OP(3), 0, OP(5) | OP(6), 0, 0 }, OP(1) | OP(4), 5, 5 },
+    // 12: 1<2; 3<4; 3<5; 3<6, feedback 2>2
+    { { OP(2), 0, OP(4) | OP(5) | OP(6), 0, 0, 0 }, OP(1) | OP(3), 1, 1 },
+    // 13: 1<2; 3<4; 3<5; 3<6, feedback 6>6
+    { { OP(2), 0, OP(4) | OP(5) | OP(6), 0, 0, 0 }, OP(1) | OP(3), 5, 5 },
+    // 14: 1<2; 3<4; 4<5; 4<6, feedback 6>6
+    { { OP(2), 0, OP(4), OP(5) | OP(6), 0, 0 }, OP(1) | OP(3), 5, 5 },
+    // 15: 1<2; 3<4; 4<5; 4<6, feedback 2>2
+    { { OP(2), 0, OP(4), OP(5) | OP(6), 0, 0 }, OP(1) | OP(3), 1, 1 },
+    // 16: 1<2; 1<3; 1<5; 3<4; 5<6, feedback 6>6
+    { { OP(2) | OP(3) | OP(5), 0, OP(4), 0, OP(6), 0 }, OP(1), 5, 5 },
+    // 17: 1<2; 1<3; 1<5; 3<4; 5<6, feedback 2>2
+    { { OP(2) | OP(3) | OP(5), 0, OP(4), 0, OP(6), 0 }, OP(1), 1, 1 },
+    // 18: 1<2; 1<3; 1<4; 4<5; 5<6, feedback 3>3
+    { { OP(2) | OP(3) | OP(4), 0, 0, OP(5), OP(6), 0 }, OP(1), 2, 2 },
+    // 19: 1<2; 2<3; 4<6; 5<6, feedback 6>6
+    { { OP(2), OP(3), 0, OP(6), OP(6), 0 }, OP(1) | OP(4) | OP(5), 5, 5 },
+    // 20: 1<3; 2<3; 4<5; 4<6, feedback 3>3
+    { { OP(3), OP(3), 0, OP(5) | OP(6), 0, 0 }, OP(1) | OP(2) | OP(4), 2, 2 },
+    // 21: 1<3; 2<3; 4<6; 5<6, feedback 3>3
+    { { OP(3), OP(3), 0, OP(6), OP(6), 0 }, OP(1) | OP(2) | OP(4) | OP(5), 2, 2 },
+    // 22: 1<2; 3<6; 4<6; 5<6, feedback 6>6
+    { { OP(2), 0, OP(6), OP(6), OP(6), 0 }, OP(1) | OP(3) | OP(4) | OP(5), 5, 5 },
+    // 23: 2<3; 4<6; 5<6, feedback 6>6
+    { { 0, OP(3), 0, OP(6), OP(6), 0 }, OP(1) | OP(2) | OP(4) | OP(5), 5, 5 },
+    // 24: 3<6; 4<6; 5<6, feedback 6>6
+    { { 0, 0, OP(6), OP(6), OP(6), 0 }, OP(1) | OP(2) | OP(3) | OP(4) | OP(5), 5, 5 },
+    // 25: 4<6; 5<6, feedback 6>6
+    { { 0, 0, 0, OP(6), OP(6), 0 }, OP(1) | OP(2) | OP(3) | OP(4) | OP(5), 5, 5 },
+    // 26: 2<3; 4<5; 4<6, feedback 6>6
+    { { 0, OP(3), 0, OP(5) | OP(6), 0, 0 }, OP(1) | OP(2) | OP(4), 5, 5 },
+    // 27: 2<3; 4<5; 4<6, feedback 3>3
+    { { 0, OP(3), 0, OP(5) | OP(6), 0, 0 }, OP(1) | OP(2) | OP(4), 2, 2 },
+    // 28: 1<2; 3<4; 4<5, feedback 5>5
+    { { OP(2), 0, OP(4), OP(5), 0, 0 }, OP(1) | OP(3) | OP(6), 4, 4 },
+    // 29: 3<4; 5<6, feedback 6>6
+    { { 0, 0, OP(4), 0, OP(6), 0 }, OP(1) | OP(2) | OP(3) | OP(5), 5, 5 },
+    // 30: 3<4; 4<5, feedback 5>5
+    { { 0, 0, OP(4), OP(5), 0, 0 }, OP(1) | OP(2) | OP(3) | OP(6), 4, 4 },
+    // 31: 5<6, feedback 6>6
+    { { 0, 0, 0, 0, OP(6), 0 }, OP(1) | OP(2) | OP(3) | OP(4) | OP(5), 5, 5 },
+    // 32: all carriers, feedback 6>6
+    { { 0, 0, 0, 0, 0, 0 }, OP(1) | OP(2) | OP(3) | OP(4) | OP(5) | OP(6), 5, 5 },
+};
+
+constexpr unsigned modulators(int algorithm, int op) { return ALGORITHMS[algorithm].modulators[op]; }
+constexpr unsigned carriers(int algorithm)           { return ALGORITHMS[algorithm].carriers; }
+constexpr bool isCarrier(int algorithm, int op)      { return (carriers(algorithm) >> op) & 1; }
+constexpr int feedbackSource(int algorithm)          { return ALGORITHMS[algorithm].feedbackSource; }
+constexpr int feedbackTarget(int algorithm)          { return ALGORITHMS[algorithm].feedbackTarget; }
+
+constexpr int lowestBit(unsigned mask)
+{
+    int bit = 0;
+
+    while (mask != 0 && (mask & 1) == 0) {
+        mask >>= 1;
+        ++bit;
+    }
+
+    return bit;
+}
+
+/**
+ * @brief Compile-time unrolled sum of w[i] * x[i] over the bits i set in Mask.
+ *
+ * Empty mask yields -0.0f, which the compiler folds away when added
+ * to another value (unlike +0.0f, x + -0.0f == x for any x).
+ * T is float, or simd::float4 for the voice bank.
+ */
+template <unsigned Mask, bool SingleBit = ((Mask & (Mask - 1)) == 0)>
+struct WeightedSum
+{
+    template <typename T>
+    static inline T get(const T* x, const T* w)
+    {
+        constexpr int i = lowestBit(Mask);
+        return w[i] * x[i] + WeightedSum<(Mask & (Mask - 1))>::get(x, w);
+    }
+};
+
+template <unsigned Mask>
+struct WeightedSum<Mask, true>
+{
+    template <typename T>
+    static inline T get(const T* x, const T* w)
+    {
+        constexpr int i = lowestBit(Mask);
+        return w[i] * x[i];
+    }
+};
+
+template <>
+struct WeightedSum<0, true>
+{
+    template <typename T>
+    static inline T get(const T*, const T*) { return T(-0.0f); }
+};
+
+} // namespace fm
@@ -1,70 +1,212 @@
+#include <algorithm>
 #include <cmath>
 #include <Arduino.h>
 #include "engine/FmSynth.h"
+#include "engine/Lut.h"
 
-#include "lut_sine.inc"
-#include "lut_dphase.inc"
-#include "lut_velocity.inc"
+//==============================================================================
+
+FmPatch::FmPatch()
+{
+    // Default sound: DX7 algorithm 5, three 2-operator stacks,
+    // the last modulator has a self-feedback.
+    op[0].level = 0.1f;
+    op[0].pan = 0.2f;
+    op[0].envelope = {0.1f, 1.5f, 0.0f, 0.25f};
+    op[0].attackVelocity = 1.0f;
+    op[0].decayVelocity = 7.0f / 3.0f;
+
+    op[1].ratio = 14.0f;
+    op[1].envelope = {0.0f, 6.0f, 0.2f, 0.5f};
+
+    op[2].level = 0.1f;
+    op[2].pan = -0.2f;
+    op[2].envelope = {0.1f, 3.0f, 0.0f, 0.25f};
+    op[2].attackVelocity = 1.0f;
+    op[2].decayVelocity = 7.0f / 3.0f;
+
+    op[3].envelope = {0.0f, 4.0f, 0.3f, 0.5f};
+
+    op[4].level = 0.02f;
+    op[4].envelope = {0.1f, 3.0f, 0.0f, 0.25f};
+    op[4].attackVelocity = 1.0f;
+
+    op[5].feedback = 0.0078125f;
+    op[5].envelope = {0.0f, 1.0f, 0.0f, 0.0f};
+}
+
+Envelope::Trigger FmPatch::Operator::velocityEnvelope(float velocity) const
+{
+    auto env = envelope;
+    env.attack /= 1.0f + 500.0f * attackVelocity * velocity;
+    env.decay *= 1.0f + decayVelocity * velocity;
+
+    return env;
+}
+
+float FmPatch::Operator::frequencyRatio() const
+{
+    const float d = detune != 0.0f ? powf(2.0f, detune * (1.0f / 1200.0f)) : 1.0f;
+    return ratio * d;
+}
 
-#define LUT_INTERPOLATE 0
+//==============================================================================
+
+void FmVoice::FmOp::setPhaseIncrement(float inc)
+{
+#if FM_FIXED_POINT_PHASE
+    // Increments above one period per sample alias anyway, keep the fraction.
+    const double p = double(inc);
+    phaseInc = uint32_t((p - floor(p)) * 4294967296.0);
+#else
+    phaseInc = inc;
+#endif
+}
 
-float sineLUT(float p)
+void FmVoice::FmOp::skip(size_t numFrames)
 {
-    const float pp = p * float (SINE_SIZE);
-    const int k = (int)pp;
+#if FM_CONTROL_RATE_ENVELOPE
+    for (size_t offset = 0; offset < numFrames; offset += Envelope::ControlBlockSize)
+        aeg.process(envelope, std::min(Envelope::ControlBlockSize, numFrames - offset));
+#else
+    for (size_t i = 0; i < numFrames; ++i)
+        aeg.next();
+#endif
 
-#if LUT_INTERPOLATE
-    const float frac = pp - (float)k;
-    return math::lerp(SINE[k], SINE[k+1], frac);
+#if FM_FIXED_POINT_PHASE
+    phase += phaseInc * uint32_t(numFrames);
 #else
-    return SINE[k];
+    phase += phaseInc * float(numFrames);
+    phase -= floorf(phase);
 #endif
 }
 
 //==============================================================================
 
-constexpr float modulationFrequency = 7.0f; // [Hz]
-constexpr float modulationDepth = 2e-4f;
+/**
+ * @brief Ticks the operators of an algorithm from Op down to 0.
+ *
+ * All the routing conditions are compile-time constants, so
+ * the render loop has no branching on the algorithm. The masked
+ * chain leaves out the operators not in the active mask, their
+ * output stays zero.
+ */
+template <int Algorithm, int Op, bool Interpolate, bool Masked>
+struct OperatorChain
+{
+    template <class Operator>
+    static inline void tick(Operator* ops, float* out, const float* modGain, float feedback, float vibrato,
+                            unsigned active, size_t k)
+    {
+        if (Masked && (active & (1u << Op)) == 0) {
+            OperatorChain<Algorithm, Op - 1, Interpolate, Masked>::tick(ops, out, modGain, feedback, vibrato, active, k);
+            return;
+        }
+
+        float pm = fm::WeightedSum<fm::modulators(Algorithm, Op)>::get(out, modGain);
+
+        if (fm::isCarrier(Algorithm, Op))
+            pm += vibrato;
+
+        if (fm::feedbackTarget(Algorithm) == Op)
+            pm += feedback * ops[fm::feedbackSource(Algorithm)].value;
+
+#if FM_CONTROL_RATE_ENVELOPE
+        out[Op] = ops[Op].template tick<Interpolate>(pm, ops[Op].envelope[k]);
+#else
+        out[Op] = ops[Op].template tick<Interpolate>(pm, ops[Op].aeg.next());
+#endif
+
+        OperatorChain<Algorithm, Op - 1, Interpolate, Masked>::tick(ops, out, modGain, feedback, vibrato, active, k);
+    }
+};
+
+template <int Algorithm, bool Interpolate, bool Masked>
+struct OperatorChain<Algorithm, -1, Interpolate, Masked>
+{
+    template <class Operator>
+    static inline void tick(Operator*, float*, const float*, float, float, unsigned, size_t) {}
+};
+
+std::atomic<uint32_t> FmVoice::s_skippedOperatorBlocks(0);
+
+const FmVoice::RenderFunc FmVoice::renderers[2][fm::NUM_ALGORITHMS] = {
+    {
+        &FmVoice::render<0, false, false>,  &FmVoice::render<1, false, false>,  &FmVoice::render<2, false, false>,  &FmVoice::render<3, false, false>,
+        &FmVoice::render<4, false, false>,  &FmVoice::render<5, false, false>,  &FmVoice::render<6, false, false>,  &FmVoice::render<7, false, false>,
+        &FmVoice::render<8, false, false>,  &FmVoice::render<9, false, false>,  &FmVoice::render<10, false, false>, &FmVoice::render<11, false, false>,
+        &FmVoice::render<12, false, false>, &FmVoice::render<13, false, false>, &FmVoice::render<14, false, false>, &FmVoice::render<15, false, false>,
+        &FmVoice::render<16, false, false>, &FmVoice::render<17, false, false>, &FmVoice::render<18, false, false>, &FmVoice::render<19, false, false>,
+        &FmVoice::render<20, false, false>, &FmVoice::render<21, false, false>, &FmVoice::render<22, false, false>, &FmVoice::render<23, false, false>,
+        &FmVoice::render<24, false, false>, &FmVoice::render<25, false, false>, &FmVoice::render<26, false, false>, &FmVoice::render<27, false, false>,
+        &FmVoice::render<28, false, false>, &FmVoice::render<29, false, false>, &FmVoice::render<30, false, false>, &FmVoice::render<31, false, false>,
+    },
+    {
+        &FmVoice::render<0, true, false>,  &FmVoice::render<1, true, false>,  &FmVoice::render<2, true, false>,  &FmVoice::render<3, true, false>,
+        &FmVoice::render<4, true, false>,  &FmVoice::render<5, true, false>,  &FmVoice::render<6, true, false>,  &FmVoice::render<7, true, false>,
+        &FmVoice::render<8, true, false>,  &FmVoice::render<9, true, false>,  &FmVoice::render<10, true, false>, &FmVoice::render<11, true, false>,
+        &FmVoice::render<12, true, false>, &FmVoice::render<13, true, false>, &FmVoice::render<14, true, false>, &FmVoice::render<15, true, false>,
+        &FmVoice::render<16, true, false>, &FmVoice::render<17, true, false>, &FmVoice::render<18, true, false>, &FmVoice::render<19, true, false>,
+        &FmVoice::render<20, true, false>, &FmVoice::render<21, true, false>, &FmVoice::render<22, true, false>, &FmVoice::render<23, true, false>,
+        &FmVoice::render<24, true, false>, &FmVoice::render<25, true, false>, &FmVoice::render<26, true, false>, &FmVoice::render<27, true, false>,
+        &FmVoice::render<28, true, false>, &FmVoice::render<29, true, false>, &FmVoice::render<30, true, false>, &FmVoice::render<31, true, false>,
+    },
+};
+
+const FmVoice::RenderFunc FmVoice::maskedRenderers[2][fm::NUM_ALGORITHMS] = {
+    {
+        &FmVoice::render<0, false, true>,  &FmVoice::render<1, false, true>,  &FmVoice::render<2, false, true>,  &FmVoice::render<3, false, true>,
+        &FmVoice::render<4, false, true>,  &FmVoice::render<5, false, true>,  &FmVoice::render<6, false, true>,  &FmVoice::render<7, false, true>,
+        &FmVoice::render<8, false, true>,  &FmVoice::render<9, false, true>,  &FmVoice::render<10, false, true>, &FmVoice::render<11, false, true>,
+        &FmVoice::render<12, false, true>, &FmVoice::render<13, false, true>, &FmVoice::render<14, false, true>, &FmVoice::render<15, false, true>,
+        &FmVoice::render<16, false, true>, &FmVoice::render<17, false, true>, &FmVoice::render<18, false, true>, &FmVoice::render<19, false, true>,
+        &FmVoice::render<20, false, true>, &FmVoice::render<21, false, true>, &FmVoice::render<22, false, true>, &FmVoice::render<23, false, true>,
+        &FmVoice::render<24, false, true>, &FmVoice::render<25, false, true>, &FmVoice::render<26, false, true>, &FmVoice::render<27, false, true>,
+        &FmVoice::render<28, false, true>, &FmVoice::render<29, false, true>, &FmVoice::render<30, false, true>, &FmVoice::render<31, false, true>,
+    },
+    {
+        &FmVoice::render<0, true, true>,  &FmVoice::render<1, true, true>,  &FmVoice::render<2, true, true>,  &FmVoice::render<3, true, true>,
+        &FmVoice::render<4, true, true>,  &FmVoice::render<5, true, true>,  &FmVoice::render<6, true, true>,  &FmVoice::render<7, true, true>,
+        &FmVoice::render<8, true, true>,  &FmVoice::render<9, true, true>,  &FmVoice::render<10, true, true>, &FmVoice::render<11, true, true>,
+        &FmVoice::render<12, true, true>, &FmVoice::render<13, true, true>, &FmVoice::render<14, true, true>, &FmVoice::render<15, true, true>,
+        &FmVoice::render<16, true, true>, &FmVoice::render<17, true, true>, &FmVoice::render<18, true, true>, &FmVoice::render<19, true, true>,
+        &FmVoice::render<20, true, true>, &FmVoice::render<21, true, true>, &FmVoice::render<22, true, true>, &FmVoice::render<23, true, true>,
+        &FmVoice::render<24, true, true>, &FmVoice::render<25, true, true>, &FmVoice::render<26, true, true>, &FmVoice::render<27, true, true>,
+        &FmVoice::render<28, true, true>, &FmVoice::render<29, true, true>, &FmVoice::render<30, true, true>, &FmVoice::render<31, true, true>,
+    },
+};
+
+//==============================================================================
 
 FmVoice::FmVoice()
+    : m_patch(nullptr)
+    , m_gain(0.0f)
+    , m_modPhase(0.0f)
+    , m_modulation(0.0f)
+    , m_feedbackGain(0.0f)
+    , m_activeOperators(0)
+    , m_skippedOperators(0)
+    , m_sineInterpolation(true)
 {
-    // Prepare static envelopes
-    m_operator[1].aeg.prepare({0.0f, 6.0f, 0.2f, 0.5f});
-    m_operator[3].aeg.prepare({0.0f, 4.0f, 0.3f, 0.5f});
-    m_operator[5].aeg.prepare({0.0f, 1.0f, 0.0f, 0.0f});
 }
 
 void FmVoice::trigger (int note, int velocity)
 {
     Voice::trigger(note, velocity);
 
-    m_gain = 0.2f + 0.8f * VELOCITY_CURVE[velocity];
+    m_gain = 0.2f + 0.8f * lut::VELOCITY_CURVE[velocity];
 
     m_modPhase = 0.0f;
 
     const float v = float(velocity) * (1.0f / 127.0f);
-    const float attack = 0.1f / (1.0f + 500.0f * v);
-    const float decay = 3.0f + 7.0f * v;
-
-    const float dp = DPHASE[note];
-
-    m_operator[0].phaseInc = dp;
-    m_operator[0].aeg.trigger({attack, 0.5f * decay, 0.0f, 0.25f});
-
-    m_operator[1].phaseInc = 14.0f * dp;
-    m_operator[1].aeg.trigger();
+    const float dp = lut::DPHASE[note];
 
-    m_operator[2].phaseInc = dp;
-    m_operator[2].aeg.trigger({attack, decay, 0.0f, 0.25f});
-
-    m_operator[3].phaseInc = 1.0f * dp;
-    m_operator[3].aeg.trigger();
-
-    m_operator[4].phaseInc = dp;
-    m_operator[4].aeg.trigger({attack, 3.0f, 0.0f, 0.25f});
+    for (size_t i = 0; i < NUM_OPS; ++i) {
+        const auto& op = m_patch->op[i];
 
-    m_operator[5].phaseInc = dp;
-    m_operator[5].aeg.trigger();
+        m_operator[i].setPhaseIncrement(op.frequencyRatio() * dp);
+        m_operator[i].aeg.trigger(op.velocityEnvelope(v));
+    }
 }
 
 void FmVoice::release()
@@ -73,10 +215,16 @@ void FmVoice::release()
         m_operator[i].aeg.release();
 }
 
+void FmVoice::release(float time)
+{
+    for (size_t i = 0; i < NUM_OPS; ++i)
+        m_operator[i].aeg.release(time);
+}
+
 void FmVoice::reset()
 {
     for (size_t i = 0; i < NUM_OPS; ++i) {
-        m_operator[i].phase = 0.0f;
+        m_operator[i].phase = 0;
         m_operator[i].value = 0.0f;
     }
 
@@ -87,65 +235,254 @@ void FmVoice::process(float* outL, float* outR, size_t numFrames)
 {
     // Tone
     constexpr float s = 0.0078125f;
-    const float tone = 2.0f * s * (*params)[FmInstrument::TONE].value();
+    const float tone = 2.0f * s * (*params)[FmParams::TONE].value();
 
     // Modulation
-    const float modulation = modulationDepth * (*params)[FmInstrument::MODULATION].value();
+    m_modulation = modulationDepth * (*params)[FmParams::MODULATION].value();
+
+    const int algorithm = math::clamp(0, fm::NUM_ALGORITHMS - 1,
+                                      int((*params)[FmParams::ALGORITHM].target() + 0.5f));
+
+    for (size_t i = 0; i < NUM_OPS; ++i) {
+        const auto& op = m_patch->op[i];
+        const float gain = m_gain * op.level;
+
+        m_modGain[i] = tone * op.level;
+        m_gainL[i] = 0.5f * gain * (1.0f - op.pan);
+        m_gainR[i] = 0.5f * gain * (1.0f + op.pan);
+    }
+
+    m_feedbackGain = m_patch->op[fm::ALGORITHMS[algorithm].feedbackTarget].feedback;
 
-    for (size_t i = 0; i < numFrames; ++i) {
-        const float m = modulation * sineLUT(m_modPhase);
+    constexpr unsigned allOperators = (1u << NUM_OPS) - 1;
+    const unsigned active = activeOperators(algorithm);
 
-        float a = m_operator[0].tick(tone * (m_operator[1].tick()) + m);    
-        float b = m_operator[2].tick(tone * (m_operator[3].tick()) + m);
-        float c = m_operator[4].tick(tone * (m_operator[5].tick(s * m_operator[5].value)));
-        
-        // Update modulation phase
-        constexpr float modInc = modulationFrequency * globals::SAMPLE_RATE_R;
-        m_modPhase += modInc;
+    if (active != allOperators) {
+        // Operators are skipped for this block only, the tone or the feedback
+        // may bring them back. Their envelopes keep running, and only those
+        // whose own output has died out are switched off, so that the voice
+        // gets recycled as soon as all the carriers are silent. The output
+        // gain of a carrier is set for the whole note.
+        for (size_t i = 0; i < NUM_OPS; ++i) {
+            if ((active & (1u << i)) == 0) {
+                auto& op = m_operator[i];
+                const float weight = fm::isCarrier(algorithm, i) ? std::max(m_gainL[i], m_gainR[i]) : 1.0f;
 
-        while (m_modPhase > 1.0f)
-            m_modPhase -= 1.0f;
+                if (op.aeg.state() != Envelope::Attack && op.aeg.level() * weight < silenceThreshold)
+                    op.aeg.stop();
+                else
+                    op.skip(numFrames);
 
-        // Mix operators
-        const float l = 0.04f * a + 0.06f * b + 0.01f * c;
-        const float r = 0.06f * a + 0.04f * b + 0.01f * c;
+                op.value = 0.0f;
+            }
+        }
 
-        outL[i] += l * m_gain;
-        outR[i] += r * m_gain;
+        m_skippedOperators |= allOperators & ~active;
+
+        if (active == 0)
+            return;
+    }
+
+    m_activeOperators = active;
+
+    // The render loop is picked once per block: the whole chain without any
+    // test, plain sines when only carriers without feedback are left, or
+    // the chain of the active operators.
+    const unsigned feedbackPair = (1u << fm::feedbackSource(algorithm)) | (1u << fm::feedbackTarget(algorithm));
+
+    if (active == allOperators) {
+        (this->*renderers[m_sineInterpolation][algorithm])(outL, outR, numFrames);
+    } else if ((active & ~fm::carriers(algorithm)) == 0 && (active & feedbackPair) != feedbackPair) {
+        if (m_sineInterpolation)
+            renderCarriers<true>(outL, outR, numFrames);
+        else
+            renderCarriers<false>(outL, outR, numFrames);
+    } else {
+        (this->*maskedRenderers[m_sineInterpolation][algorithm])(outL, outR, numFrames);
     }
 }
 
-bool FmVoice::shouldRecycle()
+unsigned FmVoice::activeOperators(int algorithm) const
+{
+    constexpr float twoPi = 6.283185307f;
+
+    // An operator is audible while in attack, otherwise its level
+    // only decreases until the next trigger.
+    const auto audible = [this](size_t op, float weight) {
+        const auto& aeg = m_operator[op].aeg;
+        return aeg.state() == Envelope::Attack || aeg.level() * weight >= silenceThreshold;
+    };
+
+    const auto& alg = fm::ALGORITHMS[algorithm];
+    unsigned active = 0;
+
+    for (size_t op = 0; op < NUM_OPS; ++op) {
+        if (fm::isCarrier(algorithm, op) && audible(op, std::max(m_gainL[op], m_gainR[op])))
+            active |= 1u << op;
+    }
+
+    // Modulators have higher indices than the operators they modulate,
+    // the second pass picks up the modulators of the feedback source.
+    for (int pass = 0; pass < 2; ++pass) {
+        for (size_t op = 0; op < NUM_OPS; ++op) {
+            if ((active & (1u << op)) == 0)
+                continue;
+
+            for (size_t mod = op + 1; mod < NUM_OPS; ++mod) {
+                // A phase deviation d changes the output by up to 2 pi d
+                if ((alg.modulators[op] & (1u << mod)) && audible(mod, twoPi * m_modGain[mod]))
+                    active |= 1u << mod;
+            }
+        }
+
+        if ((active & (1u << alg.feedbackTarget)) && audible(alg.feedbackSource, twoPi * m_feedbackGain))
+            active |= 1u << alg.feedbackSource;
+    }
+
+    return active;
+}
+
+template <int Algorithm, bool Interpolate, bool Masked>
+void FmVoice::render(float* outL, float* outR, size_t numFrames)
 {
-    return m_operator[0].aeg.state() == Envelope::State::Off
-        && m_operator[2].aeg.state() == Envelope::State::Off
-        && m_operator[4].aeg.state() == Envelope::State::Off;
+    constexpr unsigned carriers = fm::carriers(Algorithm);
+
+    // Local copies, so that the gains stay in registers.
+    float modGain[NUM_OPS];
+    float gainL[NUM_OPS];
+    float gainR[NUM_OPS];
+
+    for (size_t i = 0; i < NUM_OPS; ++i) {
+        modGain[i] = m_modGain[i];
+        gainL[i] = m_gainL[i];
+        gainR[i] = m_gainR[i];
+    }
+
+    const float modulation = m_modulation;
+    const float feedback = m_feedbackGain;
+
+    const unsigned active = m_activeOperators;
+
+    float out[NUM_OPS] = {};
+
+    constexpr size_t controlBlockSize = Envelope::ControlBlockSize;
+
+    for (size_t offset = 0; offset < numFrames; offset += controlBlockSize) {
+        const size_t n = std::min(controlBlockSize, numFrames - offset);
+
+#if FM_CONTROL_RATE_ENVELOPE
+        for (size_t op = 0; op < NUM_OPS; ++op) {
+            if (! Masked || (active & (1u << op)))
+                m_operator[op].aeg.process(m_operator[op].envelope, n);
+        }
+#endif
+
+        for (size_t k = 0; k < n; ++k) {
+            const size_t i = offset + k;
+            const float m = modulation * sineLUT(m_modPhase);
+
+            OperatorChain<Algorithm, NUM_OPS - 1, Interpolate, Masked>::tick(m_operator, out, modGain, feedback, m, active, k);
+
+            // Update modulation phase
+            constexpr float modInc = modulationFrequency * globals::SAMPLE_RATE_R;
+            m_modPhase += modInc;
+
+            while (m_modPhase > 1.0f)
+                m_modPhase -= 1.0f;
+
+            // Mix carriers
+            outL[i] += fm::WeightedSum<carriers>::get(out, gainL);
+            outR[i] += fm::WeightedSum<carriers>::get(out, gainR);
+        }
+    }
 }
 
-float FmVoice::envelopeLevel() const
+template <bool Interpolate>
+void FmVoice::renderCarriers(float* outL, float* outR, size_t numFrames)
 {
-    // Should take the slowest envelope here.
-    return m_operator[0].aeg.level();
+    constexpr size_t controlBlockSize = Envelope::ControlBlockSize;
+
+    const float modulation = m_modulation;
+    const unsigned active = m_activeOperators;
+
+    float vibrato[controlBlockSize];
+    float mixL[controlBlockSize];
+    float mixR[controlBlockSize];
+
+    for (size_t offset = 0; offset < numFrames; offset += controlBlockSize) {
+        const size_t n = std::min(controlBlockSize, numFrames - offset);
+
+        for (size_t k = 0; k < n; ++k) {
+            vibrato[k] = modulation * sineLUT(m_modPhase);
+
+            constexpr float modInc = modulationFrequency * globals::SAMPLE_RATE_R;
+            m_modPhase += modInc;
+
+            while (m_modPhase > 1.0f)
+                m_modPhase -= 1.0f;
+
+            mixL[k] = 0.0f;
+            mixR[k] = 0.0f;
+        }
+
+        // Each carrier is only modulated by the vibrato, so they are rendered
+        // one after the other. Mixed from the highest one down, the sums are
+        // the same as those of the operator chain.
+        for (size_t op = NUM_OPS; op-- > 0;) {
+            if ((active & (1u << op)) == 0)
+                continue;
+
+            auto& o = m_operator[op];
+            const float gainL = m_gainL[op];
+            const float gainR = m_gainR[op];
+
+#if FM_CONTROL_RATE_ENVELOPE
+            o.aeg.process(o.envelope, n);
+#endif
+
+            for (size_t k = 0; k < n; ++k) {
+#if FM_CONTROL_RATE_ENVELOPE
+                const float x = o.template tick<Interpolate>(vibrato[k], o.envelope[k]);
+#else
+                const float x = o.template tick<Interpolate>(vibrato[k], o.aeg.next());
+#endif
+                mixL[k] = gainL * x + mixL[k];
+                mixR[k] = gainR * x + mixR[k];
+            }
+        }
+
+        for (size_t k = 0; k < n; ++k) {
+            outL[offset + k] += mixL[k];
+            outR[offset + k] += mixR[k];
+        }
+    }
 }
 
-//==============================================================================
+void FmVoice::endBlock()
+{
+    // Each operator is counted once per block, however many
+    // times the block was split by MIDI events.
+    for (unsigned mask = m_skippedOperators; mask != 0; mask &= mask - 1)
+        s_skippedOperatorBlocks.fetch_add(1, std::memory_order_relaxed);
 
-FmInstrument::FmInstrument()
-    : PolyphonicInstrument(NUM_PARAMS)
-    , m_reverb()
+    m_skippedOperators = 0;
+}
+
+bool FmVoice::shouldRecycle()
 {
-    effects().append(&m_reverb);
+    const int algorithm = math::clamp(0, fm::NUM_ALGORITHMS - 1,
+                                      int((*params)[FmParams::ALGORITHM].target() + 0.5f));
 
-    parameters()[MODULATION].setValue(0.0f, true);
-    parameters()[TONE].setValue(0.5f, true);
+    for (size_t i = 0; i < NUM_OPS; ++i) {
+        if (fm::isCarrier(algorithm, i) && m_operator[i].aeg.state() != Envelope::State::Off)
+            return false;
+    }
 
-    mapCC(MidiMessage::CC_Modulation, MODULATION);
-    mapCC(16, TONE);
+    return true;
+}
 
-    m_reverb.parameters()[fx::Reverb::DRY].setValue(1.0f, true);
-    m_reverb.parameters()[fx::Reverb::WET].setValue(0.4f, true);
-    m_reverb.parameters()[fx::Reverb::ROOM_SIZE].setValue(0.87f, true);
-    m_reverb.parameters()[fx::Reverb::WIDTH].setValue(1.0f, true);
-    m_reverb.parameters()[fx::Reverb::PITCH].setValue(1.0f, true);
-    m_reverb.parameters()[fx::Reverb::FEEDBACK].setValue(0.0f, true);
+float FmVoice::envelopeLevel() const
+{
+    // Should take the slowest envelope here.
+    return m_operator[0].aeg.level();
 }
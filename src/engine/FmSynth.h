@@ -1,17 +1,77 @@
 #pragma once
 
 #include <array>
+#include <atomic>
 
 #include "engine/Voice.h"
 #include "engine/Envelope.h"
+#include "engine/Sine.h"
+#include "engine/FmAlgorithm.h"
 #include "engine/Instrument.h"
 
 #include "engine/FX_LowPass.h"
 #include "engine/FX_Distortion.h"
 #include "engine/FX_Delay.h"
 #include "engine/FX_Reverb.h"
+#include "engine/FX_FdnReverb.h"
 
-float sineLUT(float p);
+/**
+ * FmVoice operators phase accumulator:
+ * 1 - wrapping 32-bit fixed point phase (no drift, no wrapping branches),
+ * 0 - float phase.
+ */
+#ifndef FM_FIXED_POINT_PHASE
+#   define FM_FIXED_POINT_PHASE 1
+#endif
+
+/**
+ * FmVoice operators envelopes evaluation:
+ * 1 - control rate, see Envelope::process(),
+ * 0 - per sample.
+ */
+#ifndef FM_CONTROL_RATE_ENVELOPE
+#   define FM_CONTROL_RATE_ENVELOPE 1
+#endif
+
+// Operators contributing less than this are skipped (-96 dBFS)
+constexpr float silenceThreshold = 1.5849e-5f;
+
+// Mod wheel vibrato
+constexpr float modulationFrequency = 7.0f; // [Hz]
+constexpr float modulationDepth = 2e-4f;
+
+/**
+ * @brief FM voice settings shared by all the voices of an instrument.
+ *
+ * The routing algorithm is selected by the FmParams::ALGORITHM parameter.
+ */
+struct FmPatch
+{
+    struct Operator
+    {
+        float ratio          = 1.0f;   // Frequency ratio to the note frequency
+        float detune         = 0.0f;   // [cents]
+        float level          = 1.0f;   // Output level for carriers, modulation index for modulators
+        float pan            = 0.0f;   // Carriers stereo position, -1 (left) to 1 (right)
+        float feedback       = 0.0f;   // Feedback amount, used when this is the algorithm's feedback target
+        float attackVelocity = 0.0f;   // Attack time is divided by (1 + 500 * attackVelocity * velocity)
+        float decayVelocity  = 0.0f;   // Decay time is multiplied by (1 + decayVelocity * velocity)
+
+        Envelope::Trigger envelope;
+
+        /// Envelope scaled by the normalized note velocity.
+        Envelope::Trigger velocityEnvelope(float velocity) const;
+
+        /// Ratio with detune applied.
+        float frequencyRatio() const;
+    };
+
+    FmPatch();
+
+    Operator op[fm::NUM_OPERATORS];
+};
+
+//==============================================================================
 
 class FmVoice : public Voice,
                 public ListItem<FmVoice>
@@ -19,14 +79,60 @@ class FmVoice : public Voice,
 public:
     struct FmOp
     {
+#if FM_FIXED_POINT_PHASE
+        // Phase as a fraction of the period, wraps naturally
+        uint32_t phase = 0;
+        uint32_t phaseInc = 0;
+#else
         float phase = 0.0f;
         float phaseInc = 0.0f;
+#endif
 
         Envelope aeg;
 
+#if FM_CONTROL_RATE_ENVELOPE
+        // Envelope levels of the current control block
+        float envelope[Envelope::ControlBlockSize];
+#endif
+
         float value = 0.0f;
 
+        /// Set the phase increment [periods per sample].
+        void setPhaseIncrement(float inc);
+
+        /// Advance the envelope and the phase without rendering.
+        void skip(size_t numFrames);
+
         inline float tick(float pmod = 0.0f)
+        {
+            return tick(pmod, aeg.next());
+        }
+
+        /// Sine of the phase, see fastSineLUT().
+        template <bool Interpolate, typename Phase>
+        static inline float sine(Phase p)
+        {
+            return Interpolate ? sineLUT(p) : fastSineLUT(p);
+        }
+
+#if FM_FIXED_POINT_PHASE
+
+        template <bool Interpolate = true>
+        inline float tick(float pmod, float level)
+        {
+            // Phase modulation wrapped to (-1, 1) period and converted
+            // to 2^-31 units, so the conversion cannot overflow.
+            const float pm = pmod - float(int32_t(pmod));
+            phase += phaseInc + (uint32_t(int32_t(pm * 2147483648.0f)) << 1);
+
+            value = level * sine<Interpolate>(phase);
+            return value;
+        }
+
+#else
+
+        template <bool Interpolate = true>
+        inline float tick(float pmod, float level)
         {
             phase += phaseInc + pmod;
    
@@ -38,40 +144,83 @@ public:
             if (phase < 0.0f)
                 phase = 0.0f;
 
-            value = aeg.next() * sineLUT(phase);
+            value = level * sine<Interpolate>(phase);
             return value;
         }
+
+#endif
     };
 
     static float fmProcess(FmOp* op);
 
     FmVoice();
 
+    void setPatch(const FmPatch* patch) { m_patch = patch; }
+
     void trigger(int note, int velocity) override;
     void release() override;
+    void release(float time) override;
     void reset() override;
     void process(float* outL, float* outR, size_t numFrames) override;
+    void endBlock() override;
     bool shouldRecycle() override;
     float envelopeLevel() const override;
 
+    /// Selected kernel (default) or cheaper sine of the operators, see fastSineLUT().
+    void setSineInterpolation(bool interpolate) { m_sineInterpolation = interpolate; }
+
+    /// Operator blocks skipped by all the voices as silent or unused.
+    static uint32_t skippedOperatorBlocks() { return s_skippedOperatorBlocks.load(std::memory_order_relaxed); }
+
 private:
 
+    constexpr static size_t NUM_OPS = fm::NUM_OPERATORS;
+
+    template <int Algorithm, bool Interpolate, bool Masked>
+    void render(float* outL, float* outR, size_t numFrames);
+
+    // Only the active carriers, modulated by the vibrato alone
+    template <bool Interpolate>
+    void renderCarriers(float* outL, float* outR, size_t numFrames);
+
+    // Mask of the operators that contribute to the output in this block
+    unsigned activeOperators(int algorithm) const;
+
+    static std::atomic<uint32_t> s_skippedOperatorBlocks;
+
+    using RenderFunc = void (FmVoice::*)(float*, float*, size_t);
+
+    // render() instantiated for every algorithm, with and without sine interpolation,
+    // for all the operators active and for the operators of m_activeOperators only
+    static const RenderFunc renderers[2][fm::NUM_ALGORITHMS];
+    static const RenderFunc maskedRenderers[2][fm::NUM_ALGORITHMS];
+
+    const FmPatch* m_patch;
+
     float m_gain;
     Envelope m_adsr;
     float m_modPhase;
 
-    constexpr static size_t NUM_OPS = 6;
+    // Per-block values used by render()
+    float m_modulation;
+    float m_feedbackGain;
+    unsigned m_activeOperators;
+    unsigned m_skippedOperators;    // Operators skipped in any part of the block
+    bool m_sineInterpolation;
+    float m_modGain[NUM_OPS];
+    float m_gainL[NUM_OPS];
+    float m_gainR[NUM_OPS];
+
     FmOp m_operator[NUM_OPS];
 };
 
 //==============================================================================
 
-using PolyphonicInstrument = Instrument<FmVoice, 16>;
-
-class FmInstrument : public PolyphonicInstrument
+/**
+ * @brief Parameters shared by the FM instruments.
+ */
+struct FmParams
 {
-public:
-
     enum Params
     {
         ADSR_ATTACK = 0,
@@ -81,13 +230,95 @@ public:
 
         MODULATION, // Mod wheel, cc1
         TONE,
+        ALGORITHM,  // 0..31, DX7 algorithms 1..32
 
         NUM_PARAMS
     };
+};
 
-    FmInstrument();
+/**
+ * @brief FM instrument set-up common to the per-voice
+ *        and the voice bank (see FmBankInstrument) renderers.
+ */
+template <class VoiceType, size_t Polyphony>
+class FmInstrumentBase : public Instrument<VoiceType, Polyphony>,
+                         public FmParams
+{
+public:
 
-private:
+#if defined(ENGINE_FDN_REVERB)
+    using Reverb = fx::FdnReverb;
+#else
+    using Reverb = fx::Reverb;
+#endif
+
+    FmInstrumentBase()
+        : Instrument<VoiceType, Polyphony>(NUM_PARAMS)
+        , m_patch()
+        , m_reverb()
+    {
+        for (auto& voice : this->voices())
+            voice.setPatch(&m_patch);
+
+        this->effects().append(&m_reverb);
+
+        auto& params = this->parameters();
+
+        params[MODULATION].setValue(0.0f, true);
+        params[TONE].setValue(0.5f, true);
+
+        // DX7 algorithm 5, see FmPatch::FmPatch()
+        params[ALGORITHM].setRange(0.0f, float(fm::NUM_ALGORITHMS - 1));
+        params[ALGORITHM].setValue(4.0f, true);
+
+        this->mapCC(MidiMessage::CC_Modulation, MODULATION);
+        this->mapCC(16, TONE);
+
+        m_reverb.parameters()[Reverb::DRY].setValue(1.0f, true);
+        m_reverb.parameters()[Reverb::WET].setValue(0.4f, true);
+        m_reverb.parameters()[Reverb::ROOM_SIZE].setValue(0.87f, true);
+        m_reverb.parameters()[Reverb::WIDTH].setValue(1.0f, true);
+#if !defined(ENGINE_FDN_REVERB)
+        m_reverb.parameters()[Reverb::PITCH].setValue(1.0f, true);
+        m_reverb.parameters()[Reverb::FEEDBACK].setValue(0.0f, true);
+#endif
+    }
+
+    FmPatch& patch() { return m_patch; }
+
+    /// Lowest quality of setQuality().
+    constexpr static int MAX_QUALITY_LEVEL = SINE_KERNEL_INTERPOLATES ? 4 : 3;
 
-    fx::Reverb m_reverb;
+    /**
+     * @brief Trade sound quality for DSP load, see QualityGovernor.
+     *
+     * Every level adds a reduction to the previous ones:
+     * 1 - operators sine without interpolation,
+     * 2 - cheaper reverb,
+     * 3 - 3/4 of the voices, the quietest extra ones released quickly,
+     * 4 - half of the voices.
+     *
+     * Level 1 only exists when SINE_KERNEL interpolates, otherwise
+     * the levels start from the cheaper reverb.
+     */
+    void setQuality(int level)
+    {
+        if (! SINE_KERNEL_INTERPOLATES)
+            level += level > 0 ? 1 : 0;
+
+        for (auto& voice : this->voices())
+            voice.setSineInterpolation(level < 1);
+
+        m_reverb.setQuality(level < 2 ? Reverb::Quality::High : Reverb::Quality::Low);
+
+        this->setMaxVoices(level < 3 ? Polyphony : (level == 3 ? Polyphony * 3 / 4 : Polyphony / 2));
+    }
+
+protected:
+
+    FmPatch m_patch;
+
+    Reverb m_reverb;
 };
+
+using FmInstrument = FmInstrumentBase<FmVoice, 16>;
@@ -0,0 +1,429 @@
+#include "engine/FmVoiceBank.h"
+#include "engine/Lut.h"
+
+using simd::float4;
+
+// Envelope limit of the states that hold the level (Off, Sustain)
+constexpr float idleLimit = 1e30f;
+
+template <bool Interpolate = true>
+static inline float4 sine4(float4 phase)
+{
+    alignas(16) int32_t p[simd::LANES];
+    alignas(16) float s[simd::LANES];
+
+    // Same conversion as sine::toPhase() for all the lanes
+    simd::toInt((phase - simd::trunc(phase)) * float4(2147483648.0f), p);
+
+    for (int i = 0; i < simd::LANES; ++i)
+        s[i] = Interpolate ? sineLUT(uint32_t(p[i]) << 1) : fastSineLUT(uint32_t(p[i]) << 1);
+
+    return float4::load(s);
+}
+
+//==============================================================================
+
+/**
+ * @brief Rendering state of a group of simd::LANES voices,
+ *        kept in locals for the duration of a block.
+ */
+struct FmVoiceBank::Group
+{
+    float4 phase[NUM_OPS];
+    float4 phaseInc[NUM_OPS];
+    float4 out[NUM_OPS];
+
+    float4 level[NUM_OPS];
+    float4 coef[NUM_OPS];
+    float4 base[NUM_OPS];
+    float4 limit[NUM_OPS];
+    float4 direction[NUM_OPS];
+
+    float4 modGain[NUM_OPS];
+    float4 gainL[NUM_OPS];
+    float4 gainR[NUM_OPS];
+
+    float4 feedback;
+    float4 vibrato;
+};
+
+/**
+ * @brief Ticks the operators of an algorithm from Op down to 0
+ *        for all the voices of a group.
+ *
+ * Same routing as the FmVoice operator chain.
+ */
+template <int Algorithm, int Op, bool Interpolate>
+struct FmVoiceBank::OperatorChain
+{
+    static inline void tick(FmVoiceBank& bank, Group& g, size_t first)
+    {
+        const float4 zero(0.0f);
+
+        float4 pm = fm::WeightedSum<fm::modulators(Algorithm, Op)>::get(g.out, g.modGain);
+
+        if (fm::isCarrier(Algorithm, Op))
+            pm += g.vibrato;
+
+        if (fm::feedbackTarget(Algorithm) == Op)
+            pm += g.feedback * g.out[fm::feedbackSource(Algorithm)];
+
+        // Phase wrap, negative phase due to precision is clamped to zero.
+        float4 phase = g.phase[Op] + (g.phaseInc[Op] + pm);
+        phase = simd::max(phase - simd::trunc(phase), zero);
+        g.phase[Op] = phase;
+
+        g.level[Op] = g.base[Op] + g.level[Op] * g.coef[Op];
+
+        if (const int crossed = simd::greaterEqual((g.level[Op] - g.limit[Op]) * g.direction[Op], zero))
+            bank.advanceEnvelopes(g, Op, first, crossed);
+
+        g.out[Op] = g.level[Op] * sine4<Interpolate>(phase);
+
+        OperatorChain<Algorithm, Op - 1, Interpolate>::tick(bank, g, first);
+    }
+};
+
+template <int Algorithm, bool Interpolate>
+struct FmVoiceBank::OperatorChain<Algorithm, -1, Interpolate>
+{
+    static inline void tick(FmVoiceBank&, Group&, size_t) {}
+};
+
+const FmVoiceBank::RenderFunc FmVoiceBank::renderers[2][fm::NUM_ALGORITHMS] = {
+    {
+        &FmVoiceBank::render<0, false>,  &FmVoiceBank::render<1, false>,  &FmVoiceBank::render<2, false>,  &FmVoiceBank::render<3, false>,
+        &FmVoiceBank::render<4, false>,  &FmVoiceBank::render<5, false>,  &FmVoiceBank::render<6, false>,  &FmVoiceBank::render<7, false>,
+        &FmVoiceBank::render<8, false>,  &FmVoiceBank::render<9, false>,  &FmVoiceBank::render<10, false>, &FmVoiceBank::render<11, false>,
+        &FmVoiceBank::render<12, false>, &FmVoiceBank::render<13, false>, &FmVoiceBank::render<14, false>, &FmVoiceBank::render<15, false>,
+        &FmVoiceBank::render<16, false>, &FmVoiceBank::render<17, false>, &FmVoiceBank::render<18, false>, &FmVoiceBank::render<19, false>,
+        &FmVoiceBank::render<20, false>, &FmVoiceBank::render<21, false>, &FmVoiceBank::render<22, false>, &FmVoiceBank::render<23, false>,
+        &FmVoiceBank::render<24, false>, &FmVoiceBank::render<25, false>, &FmVoiceBank::render<26, false>, &FmVoiceBank::render<27, false>,
+        &FmVoiceBank::render<28, false>, &FmVoiceBank::render<29, false>, &FmVoiceBank::render<30, false>, &FmVoiceBank::render<31, false>,
+    },
+    {
+        &FmVoiceBank::render<0, true>,  &FmVoiceBank::render<1, true>,  &FmVoiceBank::render<2, true>,  &FmVoiceBank::render<3, true>,
+        &FmVoiceBank::render<4, true>,  &FmVoiceBank::render<5, true>,  &FmVoiceBank::render<6, true>,  &FmVoiceBank::render<7, true>,
+        &FmVoiceBank::render<8, true>,  &FmVoiceBank::render<9, true>,  &FmVoiceBank::render<10, true>, &FmVoiceBank::render<11, true>,
+        &FmVoiceBank::render<12, true>, &FmVoiceBank::render<13, true>, &FmVoiceBank::render<14, true>, &FmVoiceBank::render<15, true>,
+        &FmVoiceBank::render<16, true>, &FmVoiceBank::render<17, true>, &FmVoiceBank::render<18, true>, &FmVoiceBank::render<19, true>,
+        &FmVoiceBank::render<20, true>, &FmVoiceBank::render<21, true>, &FmVoiceBank::render<22, true>, &FmVoiceBank::render<23, true>,
+        &FmVoiceBank::render<24, true>, &FmVoiceBank::render<25, true>, &FmVoiceBank::render<26, true>, &FmVoiceBank::render<27, true>,
+        &FmVoiceBank::render<28, true>, &FmVoiceBank::render<29, true>, &FmVoiceBank::render<30, true>, &FmVoiceBank::render<31, true>,
+    },
+};
+
+//==============================================================================
+
+FmVoiceBank::FmVoiceBank()
+    : m_patch(nullptr)
+    , m_params(nullptr)
+    , m_activeVoices(0)
+    , m_sineInterpolation(true)
+    , m_modulation(0.0f)
+    , m_feedbackGain(0.0f)
+{
+    for (size_t v = 0; v < NUM_VOICES; ++v) {
+        m_gain[v] = 0.0f;
+        m_modPhase[v] = 0.0f;
+
+        for (size_t op = 0; op < NUM_OPS; ++op) {
+            m_phase[op][v] = 0.0f;
+            m_phaseInc[op][v] = 0.0f;
+            m_value[op][v] = 0.0f;
+            m_level[op][v] = 0.0f;
+            m_sustain[op][v] = 0.0f;
+            m_attack[op][v] = { 1.0f, 0.0f };
+            m_decay[op][v] = { 1.0f, 0.0f };
+            m_release[op][v] = { 1.0f, 0.0f };
+
+            enterState(op, v, Envelope::Off);
+        }
+    }
+}
+
+void FmVoiceBank::trigger(size_t voice, int note, int velocity)
+{
+    // Idle lanes keep running with their group,
+    // start from the same phase as a recycled FmVoice.
+    if ((m_activeVoices & (1u << voice)) == 0)
+        reset(voice);
+
+    m_gain[voice] = 0.2f + 0.8f * lut::VELOCITY_CURVE[velocity];
+    m_modPhase[voice] = 0.0f;
+
+    const float v = float(velocity) * (1.0f / 127.0f);
+    const float dp = lut::DPHASE[note];
+
+    Envelope envelope;
+
+    for (size_t op = 0; op < NUM_OPS; ++op) {
+        const auto& patchOp = m_patch->op[op];
+
+        envelope.prepare(patchOp.velocityEnvelope(v));
+
+        m_attack[op][voice] = envelope.segment(Envelope::Attack);
+        m_decay[op][voice] = envelope.segment(Envelope::Decay);
+        m_release[op][voice] = envelope.segment(Envelope::Release);
+        m_sustain[op][voice] = envelope.sustain();
+
+        m_phaseInc[op][voice] = patchOp.frequencyRatio() * dp;
+        m_level[op][voice] = 0.0f;
+
+        enterState(op, voice, Envelope::Attack);
+    }
+
+    m_activeVoices |= 1u << voice;
+}
+
+void FmVoiceBank::release(size_t voice)
+{
+    for (size_t op = 0; op < NUM_OPS; ++op)
+        enterState(op, voice, Envelope::Release);
+}
+
+void FmVoiceBank::release(size_t voice, float time)
+{
+    Envelope envelope;
+    envelope.release(time);
+
+    const auto segment = envelope.segment(Envelope::Release);
+
+    for (size_t op = 0; op < NUM_OPS; ++op) {
+        m_release[op][voice] = segment;
+        enterState(op, voice, Envelope::Release);
+    }
+}
+
+void FmVoiceBank::reset(size_t voice)
+{
+    for (size_t op = 0; op < NUM_OPS; ++op) {
+        m_phase[op][voice] = 0.0f;
+        m_value[op][voice] = 0.0f;
+    }
+
+    m_modPhase[voice] = 0.0f;
+    m_activeVoices &= ~(1u << voice);
+}
+
+bool FmVoiceBank::isSilent(size_t voice) const
+{
+    const int alg = algorithm();
+
+    for (size_t op = 0; op < NUM_OPS; ++op) {
+        if (fm::isCarrier(alg, op) && m_state[op][voice] != Envelope::Off)
+            return false;
+    }
+
+    return true;
+}
+
+void FmVoiceBank::process(float* outL, float* outR, size_t numFrames)
+{
+    if (m_activeVoices == 0)
+        return;
+
+    // Tone
+    constexpr float s = 0.0078125f;
+    const float tone = 2.0f * s * (*m_params)[FmParams::TONE].value();
+
+    // Modulation
+    m_modulation = modulationDepth * (*m_params)[FmParams::MODULATION].value();
+
+    const int alg = algorithm();
+
+    for (size_t i = 0; i < NUM_OPS; ++i) {
+        const auto& op = m_patch->op[i];
+
+        m_modGain[i] = tone * op.level;
+        m_levelL[i] = 0.5f * op.level * (1.0f - op.pan);
+        m_levelR[i] = 0.5f * op.level * (1.0f + op.pan);
+    }
+
+    m_feedbackGain = m_patch->op[fm::ALGORITHMS[alg].feedbackTarget].feedback;
+
+    stopSilentCarriers(alg);
+
+    const auto render = renderers[m_sineInterpolation][alg];
+    constexpr uint32_t groupMask = (1u << simd::LANES) - 1;
+
+    for (size_t group = 0; group < NUM_GROUPS; ++group) {
+        if ((m_activeVoices >> (group * simd::LANES)) & groupMask)
+            (this->*render)(group, outL, outR, numFrames);
+    }
+}
+
+template <int Algorithm, bool Interpolate>
+void FmVoiceBank::render(size_t group, float* outL, float* outR, size_t numFrames)
+{
+    constexpr unsigned carriers = fm::carriers(Algorithm);
+    const size_t first = group * simd::LANES;
+
+    Group g;
+
+    const float4 gain = float4::load(&m_gain[first]);
+
+    for (size_t op = 0; op < NUM_OPS; ++op) {
+        g.phase[op] = float4::load(&m_phase[op][first]);
+        g.phaseInc[op] = float4::load(&m_phaseInc[op][first]);
+        g.out[op] = float4::load(&m_value[op][first]);
+
+        g.level[op] = float4::load(&m_level[op][first]);
+        g.coef[op] = float4::load(&m_coef[op][first]);
+        g.base[op] = float4::load(&m_base[op][first]);
+        g.limit[op] = float4::load(&m_limit[op][first]);
+        g.direction[op] = float4::load(&m_direction[op][first]);
+
+        g.modGain[op] = float4(m_modGain[op]);
+        g.gainL[op] = gain * float4(m_levelL[op]);
+        g.gainR[op] = gain * float4(m_levelR[op]);
+    }
+
+    g.feedback = float4(m_feedbackGain);
+
+    const float4 modulation(m_modulation);
+    const float4 modInc(modulationFrequency * globals::SAMPLE_RATE_R);
+    float4 modPhase = float4::load(&m_modPhase[first]);
+
+    for (size_t i = 0; i < numFrames; ++i) {
+        g.vibrato = modulation * sine4(modPhase);
+
+        OperatorChain<Algorithm, NUM_OPS - 1, Interpolate>::tick(*this, g, first);
+
+        modPhase = modPhase + modInc;
+        modPhase = modPhase - simd::trunc(modPhase);
+
+        // Mix carriers
+        outL[i] += simd::sum(fm::WeightedSum<carriers>::get(g.out, g.gainL));
+        outR[i] += simd::sum(fm::WeightedSum<carriers>::get(g.out, g.gainR));
+    }
+
+    modPhase.store(&m_modPhase[first]);
+
+    for (size_t op = 0; op < NUM_OPS; ++op) {
+        g.phase[op].store(&m_phase[op][first]);
+        g.out[op].store(&m_value[op][first]);
+        g.level[op].store(&m_level[op][first]);
+    }
+}
+
+void FmVoiceBank::stopSilentCarriers(int alg)
+{
+    // Same rule as FmVoice::process(): a carrier past its attack and
+    // below the silence threshold is stopped, so that the voice is
+    // recycled as soon as all its carriers are.
+    for (uint32_t mask = m_activeVoices; mask != 0; mask &= mask - 1) {
+        const size_t voice = size_t(__builtin_ctz(mask));
+
+        for (size_t op = 0; op < NUM_OPS; ++op) {
+            const auto state = m_state[op][voice];
+
+            if (! fm::isCarrier(alg, op) || state == Envelope::Attack || state == Envelope::Off)
+                continue;
+
+            const float weight = m_gain[voice] * std::max(m_levelL[op], m_levelR[op]);
+
+            if (m_level[op][voice] * weight < silenceThreshold) {
+                m_level[op][voice] = 0.0f;
+                enterState(op, voice, Envelope::Off);
+            }
+        }
+    }
+}
+
+int FmVoiceBank::algorithm() const
+{
+    return math::clamp(0, fm::NUM_ALGORITHMS - 1,
+                       int((*m_params)[FmParams::ALGORITHM].target() + 0.5f));
+}
+
+void FmVoiceBank::enterState(size_t op, size_t voice, Envelope::State state)
+{
+    Envelope::Segment segment = { 1.0f, 0.0f };
+    float limit = idleLimit;
+    float direction = 1.0f;
+
+    switch (state)
+    {
+    case Envelope::Attack:
+        segment = m_attack[op][voice];
+        limit = 1.0f;
+        break;
+    case Envelope::Decay:
+        segment = m_decay[op][voice];
+        limit = m_sustain[op][voice];
+        direction = -1.0f;
+        break;
+    case Envelope::Release:
+        segment = m_release[op][voice];
+        limit = 0.0f;
+        direction = -1.0f;
+        break;
+    default:
+        break;
+    }
+
+    m_state[op][voice] = uint8_t(state);
+    m_coef[op][voice] = segment.coef;
+    m_base[op][voice] = segment.base;
+    m_limit[op][voice] = limit;
+    m_direction[op][voice] = direction;
+}
+
+void FmVoiceBank::advanceEnvelopes(Group& g, size_t op, size_t first, int crossed)
+{
+    g.level[op].store(&m_level[op][first]);
+
+    for (int lane = 0; lane < simd::LANES; ++lane) {
+        if ((crossed & (1 << lane)) == 0)
+            continue;
+
+        const size_t voice = first + lane;
+        float& level = m_level[op][voice];
+
+        switch (m_state[op][voice])
+        {
+        case Envelope::Attack:
+            level = 1.0f;
+            enterState(op, voice, Envelope::Decay);
+            break;
+        case Envelope::Decay:
+            level = m_sustain[op][voice];
+            enterState(op, voice, level > 0.0f ? Envelope::Sustain : Envelope::Off);
+            break;
+        case Envelope::Release:
+            level = 0.0f;
+            enterState(op, voice, Envelope::Off);
+            break;
+        default:
+            break;
+        }
+    }
+
+    g.level[op] = float4::load(&m_level[op][first]);
+    g.coef[op] = float4::load(&m_coef[op][first]);
+    g.base[op] = float4::load(&m_base[op][first]);
+    g.limit[op] = float4::load(&m_limit[op][first]);
+    g.direction[op] = float4::load(&m_direction[op][first]);
+}
+
+//==============================================================================
+
+FmBankInstrument::FmBankInstrument()
+    : FmInstrumentBase<FmBankVoice, FmVoiceBank::NUM_VOICES>()
+    , m_bank()
+{
+    m_bank.setPatch(&m_patch);
+    m_bank.setParametersPool(&parameters());
+
+    size_t index = 0;
+
+    for (auto& voice : voices())
+        voice.attach(&m_bank, index++);
+}
+
+void FmBankInstrument::renderVoices(float* outL, float* outR, size_t numFrames)
+{
+    PROFILE_SCOPE(perf::Profiler::Voice);
+    m_bank.process(outL, outR, numFrames);
+}
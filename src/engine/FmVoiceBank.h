@@ -0,0 +1,179 @@
+#pragma once
+
+#include "engine/FmSynth.h"
+#include "engine/Simd.h"
+
+/**
+ * @brief Structure-of-arrays renderer of FM voices.
+ *
+ * Operator phases, increments and envelope states of all the voices
+ * are stored contiguously and rendered in groups of simd::LANES voices,
+ * so that a single vector operation advances the same operator of
+ * four voices. Groups without active voices are skipped.
+ *
+ * Uses the patch, routing and voice recycling of FmVoice, carriers
+ * being stopped below silenceThreshold, but does not render the same
+ * samples:
+ * - phases are kept in float, not in 32-bit fixed point
+ * - envelopes are evaluated per sample, not at control rate
+ * - silent operators are rendered, not skipped
+ */
+class FmVoiceBank final
+{
+public:
+
+    constexpr static size_t NUM_VOICES = 32;
+    constexpr static size_t NUM_OPS = fm::NUM_OPERATORS;
+    constexpr static size_t NUM_GROUPS = NUM_VOICES / simd::LANES;
+
+    static_assert(NUM_VOICES % simd::LANES == 0, "Voices must fill the SIMD groups");
+    static_assert(NUM_VOICES <= 32, "Active voices are tracked in a 32-bit mask");
+
+    FmVoiceBank();
+
+    void setPatch(const FmPatch* patch) { m_patch = patch; }
+    void setParametersPool(ParameterPool* p) { m_params = p; }
+
+    void trigger(size_t voice, int note, int velocity);
+    void release(size_t voice);
+    void release(size_t voice, float time);
+    void reset(size_t voice);
+
+    /// Selected kernel (default) or cheaper sine of the operators, see fastSineLUT().
+    void setSineInterpolation(bool interpolate) { m_sineInterpolation = interpolate; }
+
+    /// All the carriers of the voice are off.
+    bool isSilent(size_t voice) const;
+
+    float envelopeLevel(size_t voice) const { return m_level[0][voice]; }
+
+    /// Render all the active voices.
+    void process(float* outL, float* outR, size_t numFrames);
+
+private:
+
+    struct Group;
+
+    template <int Algorithm, int Op, bool Interpolate>
+    struct OperatorChain;
+
+    template <int Algorithm, bool Interpolate>
+    void render(size_t group, float* outL, float* outR, size_t numFrames);
+
+    using RenderFunc = void (FmVoiceBank::*)(size_t, float*, float*, size_t);
+
+    // render() instantiated for every algorithm, with and without sine interpolation
+    static const RenderFunc renderers[2][fm::NUM_ALGORITHMS];
+
+    int algorithm() const;
+
+    // Stops the carriers below silenceThreshold, see isSilent()
+    void stopSilentCarriers(int alg);
+
+    void enterState(size_t op, size_t voice, Envelope::State state);
+
+    // Handles the envelope transitions of the crossed lanes
+    void advanceEnvelopes(Group& g, size_t op, size_t first, int crossed);
+
+    const FmPatch* m_patch;
+    ParameterPool* m_params;
+
+    uint32_t m_activeVoices;
+    bool m_sineInterpolation;
+
+    // Per-block values used by render()
+    float m_modulation;
+    float m_feedbackGain;
+    float m_modGain[NUM_OPS];
+    float m_levelL[NUM_OPS];
+    float m_levelR[NUM_OPS];
+
+    // Per-voice state
+    alignas(16) float m_gain[NUM_VOICES];
+    alignas(16) float m_modPhase[NUM_VOICES];
+
+    // Per-operator state, indexed [operator][voice]
+    alignas(16) float m_phase[NUM_OPS][NUM_VOICES];
+    alignas(16) float m_phaseInc[NUM_OPS][NUM_VOICES];
+    alignas(16) float m_value[NUM_OPS][NUM_VOICES];
+
+    // Envelopes, level = base + level * coef until
+    // (level - limit) * direction >= 0 triggers the next state.
+    alignas(16) float m_level[NUM_OPS][NUM_VOICES];
+    alignas(16) float m_coef[NUM_OPS][NUM_VOICES];
+    alignas(16) float m_base[NUM_OPS][NUM_VOICES];
+    alignas(16) float m_limit[NUM_OPS][NUM_VOICES];
+    alignas(16) float m_direction[NUM_OPS][NUM_VOICES];
+
+    uint8_t m_state[NUM_OPS][NUM_VOICES];
+    float m_sustain[NUM_OPS][NUM_VOICES];
+    Envelope::Segment m_attack[NUM_OPS][NUM_VOICES];
+    Envelope::Segment m_decay[NUM_OPS][NUM_VOICES];
+    Envelope::Segment m_release[NUM_OPS][NUM_VOICES];
+};
+
+//==============================================================================
+
+/**
+ * @brief Voice handle of a FmVoiceBank lane.
+ *
+ * Keeps the Instrument voice management (allocation, stealing, sustain)
+ * while the actual rendering is done by the bank for all the voices at once.
+ */
+class FmBankVoice : public Voice,
+                    public ListItem<FmBankVoice>
+{
+public:
+
+    void attach(FmVoiceBank* bank, size_t index)
+    {
+        m_bank = bank;
+        m_index = index;
+    }
+
+    // The patch is held by the bank.
+    void setPatch(const FmPatch*) {}
+
+    void setSineInterpolation(bool interpolate) { m_bank->setSineInterpolation(interpolate); }
+
+    void trigger(int note, int velocity) override
+    {
+        Voice::trigger(note, velocity);
+        m_bank->trigger(m_index, note, velocity);
+    }
+
+    void release() override { m_bank->release(m_index); }
+    void release(float time) override { m_bank->release(m_index, time); }
+    void reset() override { m_bank->reset(m_index); }
+
+    // Rendered by FmVoiceBank::process()
+    void process(float*, float*, size_t) override {}
+
+    bool shouldRecycle() override { return m_bank->isSilent(m_index); }
+    float envelopeLevel() const override { return m_bank->envelopeLevel(m_index); }
+
+private:
+
+    FmVoiceBank* m_bank = nullptr;
+    size_t m_index = 0;
+};
+
+//==============================================================================
+
+/**
+ * @brief FM instrument rendering its voices with FmVoiceBank.
+ */
+class FmBankInstrument : public FmInstrumentBase<FmBankVoice, FmVoiceBank::NUM_VOICES>
+{
+public:
+
+    FmBankInstrument();
+
+protected:
+
+    void renderVoices(float* outL, float* outR, size_t numFrames) override;
+
+private:
+
+    FmVoiceBank m_bank;
+};
@@ -2,6 +2,18 @@
 
 #include <Arduino.h>
 #include <AudioStream.h>
+#include <algorithm>
+
+// Most frames rendered at once by the engine, the effects
+// and mixing buffers are sized for it.
+#ifndef ENGINE_MAX_BLOCK_SAMPLES
+#   define ENGINE_MAX_BLOCK_SAMPLES 128
+#endif
+
+// Default internal block size of the engine, see Engine::setBlockSize().
+#ifndef ENGINE_BLOCK_SAMPLES
+#   define ENGINE_BLOCK_SAMPLES AUDIO_BLOCK_SAMPLES
+#endif
 
 namespace globals {
 
@@ -11,6 +23,12 @@ constexpr size_t AUDIO_BLOCK_SIZE = AUDIO_BLOCK_SAMPLES;
 constexpr float  AUDIO_BLOCK_US   = 1e6f * float (AUDIO_BLOCK_SAMPLES) / AUDIO_SAMPLE_RATE;
 constexpr float  AUDIO_BLOCK_US_R = 1.0f / AUDIO_BLOCK_US;
 
+constexpr size_t MAX_BLOCK_SIZE    = ENGINE_MAX_BLOCK_SAMPLES;
+constexpr size_t ENGINE_BLOCK_SIZE = std::min<size_t> (ENGINE_BLOCK_SAMPLES, MAX_BLOCK_SIZE);
+
+/// Samples per step of the block rate parameters smoothing, regardless of the block size.
+constexpr size_t SMOOTHING_BLOCK_SIZE = 128;
+
 } // namespace globals
 
 namespace math {
@@ -3,12 +3,13 @@
 #include <array>
 #include <bitset>
 #include <atomic>
-#include <map>
 #include "engine/Globals.h"
 #include "engine/Parameter.h"
+#include "engine/ControllerMap.h"
 #include "engine/MidiMessage.h"
 #include "engine/Voice.h"
 #include "engine/Effect.h"
+#include "engine/Profiler.h"
 
 template <class VoiceType, size_t Polyphony>
 class Instrument
@@ -16,10 +17,13 @@ class Instrument
 public:
 
     Instrument(size_t numParameters = 0)
-        : m_parameters(numParameters)
+        : m_parameters(numParameters, globals::SMOOTHING_BLOCK_SIZE)
     {
         m_sustained = false;
         m_numActiveVoices = 0;
+        m_numSustainedKeys = 0;
+        m_maxVoices = Polyphony;
+        m_voiceStealing = VoiceStealing::Quietest;
 
         m_voicePool.setParametersPool(&m_parameters);
     }
@@ -28,26 +32,41 @@ public:
 
     int numActiveVoices() const noexcept { return m_numActiveVoices; }
 
-    void process(float* outL, float* outR, size_t numFrames)
+    /**
+     * @brief Render a block, applying the MIDI events at their frame offsets.
+     *
+     * The voices are rendered up to each event, effects and
+     * parameters are processed once for the whole block.
+     * Event offsets must be sorted and less than numFrames.
+     */
+    void process(float* outL, float* outR, size_t numFrames, const MidiEvent* events = nullptr, size_t numEvents = 0)
     {
-        auto* voice = m_activeVoices.first();
+        {
+            PROFILE_SCOPE(perf::Profiler::Voices);
 
-        while (voice != nullptr) {
-            voice->process(outL, outR, numFrames);
+            size_t offset = 0;
 
-            if (voice->shouldRecycle()) {
-                auto* nextVoice = m_activeVoices.removeAndReturnNext(voice);
-                m_numActiveVoices -=1;
-                m_voicePool.recycle(voice);
-                voice = nextVoice;
-            } else {
-                voice = voice->next();
+            for (size_t i = 0; i < numEvents; ++i) {
+                const size_t eventOffset = events[i].offset;
+
+                if (eventOffset > offset) {
+                    renderVoices(outL + offset, outR + offset, eventOffset - offset);
+                    offset = eventOffset;
+                }
+
+                processMidiMessage(events[i].message);
             }
+
+            renderVoices(outL + offset, outR + offset, numFrames - offset);
+            recycleVoices();
         }
 
         m_effects.process(outL, outR, outL, outR, numFrames);
 
-        updateParameters();
+        {
+            PROFILE_SCOPE(perf::Profiler::Parameters);
+            updateParameters(numFrames);
+        }
     }
 
     void processMidiMessage(const MidiMessage& msg)
@@ -73,33 +92,128 @@ public:
 
     ParameterPool& parameters() { return m_parameters; }
 
-    void mapCC(int cc, int param)
+    /// Route a controller to a parameter over its whole 0..1 range, replacing its previous routes.
+    bool mapCC(int cc, int param)
     {
-        m_ccToParamMap[cc] = param;
+        if (param < 0 || size_t(param) >= m_parameters.size())
+            return false;
+
+        ControllerMap::Route route;
+        route.parameter = param;
+
+        m_controllers.clear(cc);
+        return mapCC(cc, route);
     }
 
+    /// Add a route next to the previous ones, a controller can drive several parameters.
+    bool mapCC(int cc, const ControllerMap::Route& route)
+    {
+        if (route.parameter < 0 || size_t(route.parameter) >= m_parameters.size())
+            return false;
+
+        return m_controllers.add(cc, route);
+    }
+
+    ControllerMap& controllers() { return m_controllers; }
+
     EffectChain& effects() { return m_effects; }
+    const EffectChain& effects() const { return m_effects; }
+
+    void setVoiceStealing(VoiceStealing policy) { m_voiceStealing = policy; }
+    VoiceStealing voiceStealing() const noexcept { return m_voiceStealing; }
+
+    /**
+     * @brief Limit the number of voices playing at once.
+     *
+     * New notes steal a voice once the limit is reached. When the limit
+     * is lowered, the quietest voices above it are released within
+     * releaseTime seconds instead of their own release.
+     */
+    void setMaxVoices(size_t numVoices, float releaseTime = 0.01f)
+    {
+        m_maxVoices = std::min(std::max(numVoices, size_t(1)), Polyphony);
+
+        const size_t numActive = size_t(m_numActiveVoices);
+
+        if (numActive > m_maxVoices) {
+            m_voiceIndex.forEachQuietest(numActive - m_maxVoices, [this, releaseTime](Index index) {
+                m_voicePool[index].release(releaseTime);
+            });
+        }
+    }
+
+    size_t maxVoices() const noexcept { return m_maxVoices; }
 
 protected:
 
-    virtual void updateParameters()
+    VoicePool<VoiceType, Polyphony>& voices() { return m_voicePool; }
+
+    /**
+     * @brief Render all the active voices into the output buffers.
+     *
+     * Instruments that render their voices in bulk
+     * (see FmBankInstrument) override this.
+     */
+    virtual void renderVoices(float* outL, float* outR, size_t numFrames)
+    {
+        for (auto* voice = m_activeVoices.first(); voice != nullptr; voice = voice->next()) {
+            PROFILE_SCOPE(perf::Profiler::Voice);
+            voice->process(outL, outR, numFrames);
+        }
+    }
+
+    virtual void updateParameters(size_t numFrames)
     {
-        // Advance all parameters
-        for (size_t i = 0; i < m_parameters.size(); ++i)
-            m_parameters[i].nextValue();
+        // Advance all parameters, the smoothing time
+        // does not depend on the block size.
+        m_parameters.update(numFrames);
     }
 
 private:
 
+    using Index = typename VoiceIndex<Polyphony>::Index;
+
+    Index indexOf(const VoiceType* voice) const { return Index(m_voicePool.indexOf(voice)); }
+
+    void recycleVoices()
+    {
+        auto* voice = m_activeVoices.first();
+
+        while (voice != nullptr) {
+            voice->endBlock();
+
+            if (voice->shouldRecycle()) {
+                auto* nextVoice = m_activeVoices.removeAndReturnNext(voice);
+                m_numActiveVoices -=1;
+                m_voiceIndex.deactivate(indexOf(voice));
+                m_voicePool.recycle(voice);
+                voice = nextVoice;
+            } else {
+                // Keep the stealing priority up to date.
+                m_voiceIndex.setLevel(indexOf(voice), voice->envelopeLevel());
+                voice = voice->next();
+            }
+        }
+    }
+
     void noteOn(const MidiMessage& msg)
     {
         m_keysState[msg.note()] = true;
 
-        if (auto* voice = m_voicePool.trigger(msg.note(), msg.velocity())) {
-            m_activeVoices.append(voice);
-            m_numActiveVoices += 1;
-        } else if (auto* voice = stealVoice()) {
+        if (size_t(m_numActiveVoices) < m_maxVoices) {
+            if (auto* voice = m_voicePool.trigger(msg.note(), msg.velocity())) {
+                m_activeVoices.append(voice);
+                m_numActiveVoices += 1;
+                m_voiceIndex.activate(indexOf(voice), msg.note());
+                return;
+            }
+        }
+
+        if (auto* voice = stealVoice(msg.note())) {
+            const auto index = indexOf(voice);
+            m_voiceIndex.deactivate(index);
             voice->trigger(msg.note(), msg.velocity());
+            m_voiceIndex.activate(index, msg.note());
         }
     }
 
@@ -107,44 +221,37 @@ private:
     {
         m_keysState[msg.note()] = false;
 
-        if (m_sustained)
+        if (m_sustained) {
+            // Released when the sustain pedal goes up
+            if (! m_sustainedKeys[msg.note()]) {
+                m_sustainedKeys[msg.note()] = true;
+                m_sustainedKeysList[m_numSustainedKeys++] = uint8_t(msg.note());
+            }
+
             return;
+        }
 
-        auto* voice = m_activeVoices.first();
+        releaseKey(msg.note());
+    }
 
-        while (voice != nullptr) {
-            if (voice->key() == msg.note())
-                voice->release();
+    void releaseKey(int key)
+    {
+        auto index = m_voiceIndex.firstVoice(key);
 
-            voice = voice->next();
+        while (index != VoiceIndex<Polyphony>::none) {
+            m_voicePool[index].release();
+            index = m_voiceIndex.nextVoice(index);
         }
     }
 
-    VoiceType* stealVoice()
+    VoiceType* stealVoice(int key)
     {
-        // Find the quietest voice to steal.
-        auto* voice = m_activeVoices.first();
+        const auto index = m_voiceIndex.steal(m_voiceStealing, key);
 
-        if (voice == nullptr)
+        if (index == VoiceIndex<Polyphony>::none)
             return nullptr;
 
-        auto lowestLevel = voice->envelopeLevel();
-        auto* lowestVoice = voice;
-
-        voice = voice->next();
-
-        while (voice != nullptr) {
-            const auto voiceLevel = voice->envelopeLevel();
-
-            if (voiceLevel < lowestLevel) {
-                lowestLevel = voiceLevel;
-                lowestVoice = voice;
-            }
-
-            voice = voice->next();
-        }
-
-        return lowestVoice;
+        return &m_voicePool[index];
     }
 
     void controlChange(int control, int value)
@@ -158,27 +265,25 @@ private:
             }
         }
 
-        const auto it = m_ccToParamMap.find(control);
-
-        if (it != m_ccToParamMap.end()) {
-            // Set parameter tagret value. The actualt value will
-            // be updated when updateParameters() gets called.
-            const float v = float(value) * (1.0f / 127.0f);
-            m_parameters[it->second].setValue(v);
-
-        }
+        // Set parameters target value. The actual values will
+        // be updated when updateParameters() gets called.
+        m_controllers.apply(control, value, [this](int param, float v) {
+            m_parameters[param].setValue(v);
+        });
     }
 
     void releaseSustained()
     {
-        auto* voice = m_activeVoices.first();
+        // Only the keys released while sustained are to be checked.
+        for (size_t i = 0; i < m_numSustainedKeys; ++i) {
+            const int key = m_sustainedKeysList[i];
+            m_sustainedKeys[key] = false;
 
-        while (voice != nullptr) {
-            if (! m_keysState[voice->key()])
-                voice->release();
-
-            voice = voice->next();
+            if (! m_keysState[key])
+                releaseKey(key);
         }
+
+        m_numSustainedKeys = 0;
     }
 
 
@@ -188,11 +293,19 @@ private:
     List<VoiceType> m_activeVoices;
 
     std::atomic<int> m_numActiveVoices;
+    size_t m_maxVoices;
+
+    VoiceIndex<Polyphony> m_voiceIndex;
+    VoiceStealing m_voiceStealing;
 
     std::bitset<128> m_keysState;
     bool m_sustained;
 
+    std::bitset<128> m_sustainedKeys;
+    std::array<uint8_t, 128> m_sustainedKeysList;
+    size_t m_numSustainedKeys;
+
     EffectChain m_effects;
 
-    std::map<int, int> m_ccToParamMap;
+    ControllerMap m_controllers;
 };
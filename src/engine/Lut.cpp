@@ -0,0 +1,24 @@
+#include "engine/Lut.h"
+
+namespace {
+
+constexpr auto sine = lut::makeSine<lut::SINE_SIZE>();
+constexpr auto dphase = lut::makeDPhase<lut::NUM_NOTES>(globals::SAMPLE_RATE);
+constexpr auto velocityCurve = lut::makeVelocityCurve<lut::VELOCITY_CURVE_SIZE>();
+
+// The tables must not drift from the sample rate and the tuning.
+static_assert(dphase[69] * globals::SAMPLE_RATE > 439.999f && dphase[69] * globals::SAMPLE_RATE < 440.001f,
+              "A4 must be 440 Hz");
+static_assert(dphase[81] > 1.9999f * dphase[69] && dphase[81] < 2.0001f * dphase[69], "Octave must double the pitch");
+static_assert(sine[lut::SINE_SIZE / 4] == 1.0f, "Sine table must peak at a quarter period");
+static_assert(velocityCurve[lut::VELOCITY_CURVE_SIZE - 1] == 1.0f, "Full velocity must map to unity gain");
+
+} // anonymous namespace
+
+namespace lut {
+
+const float* const SINE = sine.data;
+const float* const DPHASE = dphase.data;
+const float* const VELOCITY_CURVE = velocityCurve.data;
+
+} // namespace lut
@@ -0,0 +1,195 @@
+#pragma once
+
+#include <cstddef>
+#include "engine/Globals.h"
+
+/**
+ * Look-up tables shared by the synthesis code.
+ *
+ * Tables are generated at compile time, their sizes are template
+ * parameters and the pitch table follows globals::SAMPLE_RATE.
+ */
+
+// Sine table resolution, a power of two
+#ifndef LUT_SINE_SIZE
+#   define LUT_SINE_SIZE 4096
+#endif
+
+namespace lut {
+
+/**
+ * @brief Fixed size table that can be filled at compile time.
+ *
+ * Non-const instances live in RAM (DTCM on Teensy),
+ * constant ones in flash.
+ */
+template <size_t Size>
+struct Table
+{
+    float data[Size] {};
+
+    constexpr static size_t size() { return Size; }
+
+    constexpr float& operator[] (size_t index) { return data[index]; }
+    constexpr const float& operator[] (size_t index) const { return data[index]; }
+};
+
+namespace detail {
+
+constexpr double pi = 3.141592653589793238;
+constexpr double ln2 = 0.693147180559945309;
+
+/// Taylor series of sin(x) for |x| <= pi/2.
+constexpr double sinSeries(double x)
+{
+    double term = x;
+    double sum = x;
+
+    for (int k = 1; k < 16; ++k) {
+        term *= -x * x / double((2 * k) * (2 * k + 1));
+        sum += term;
+    }
+
+    return sum;
+}
+
+/// sin(2 pi n / d), the argument is reduced exactly to the first quadrant.
+constexpr double sinTurns(long long n, long long d)
+{
+    n %= d;
+
+    if (n < 0)
+        n += d;
+
+    // Position within the quadrant in 1 / (4 d) of the period
+    const long long x = 4 * n;
+    const long long quadrant = x / d;
+    const long long r = x - quadrant * d;
+
+    const double q = double(r) / double(d) * 0.5 * pi;
+
+    switch (quadrant) {
+        case 0:  return sinSeries(q);
+        case 1:  return sinSeries(0.5 * pi - q);
+        case 2:  return -sinSeries(q);
+        default: return -sinSeries(0.5 * pi - q);
+    }
+}
+
+/// Taylor series of exp(x) for |x| <= 1.
+constexpr double expSeries(double x)
+{
+    double term = 1.0;
+    double sum = 1.0;
+
+    for (int k = 1; k < 24; ++k) {
+        term *= x / double(k);
+        sum += term;
+    }
+
+    return sum;
+}
+
+/// 2^(n / 12)
+constexpr double semitones(int n)
+{
+    double octaves = 1.0;
+
+    while (n >= 12) {
+        octaves *= 2.0;
+        n -= 12;
+    }
+
+    while (n < 0) {
+        octaves *= 0.5;
+        n += 12;
+    }
+
+    return octaves * expSeries(double(n) / 12.0 * ln2);
+}
+
+constexpr double sqrt(double x)
+{
+    if (x <= 0.0)
+        return 0.0;
+
+    double y = x > 1.0 ? x : 1.0;
+
+    for (int i = 0; i < 64; ++i)
+        y = 0.5 * (y + x / y);
+
+    return y;
+}
+
+} // namespace detail
+
+/// One period of sine plus a guard point.
+template <size_t Size>
+constexpr Table<Size + 1> makeSine()
+{
+    static_assert((Size & (Size - 1)) == 0, "Sine table size must be a power of two");
+
+    Table<Size + 1> t;
+
+    for (size_t i = 0; i < Size; ++i)
+        t[i] = float(detail::sinTurns((long long) i, (long long) Size));
+
+    t[Size] = 0.0f;
+    return t;
+}
+
+/**
+ * @brief Quarter-wave sine, sin(pi/2 * i / Size) for i = -1 .. Size + 2.
+ *
+ * The guard points let the interpolators read past the quarter edges.
+ */
+template <size_t Size>
+constexpr Table<Size + 4> makeQuarterSine()
+{
+    Table<Size + 4> t;
+
+    for (size_t i = 0; i < Size + 4; ++i)
+        t[i] = float(detail::sinTurns((long long) i - 1, 4 * (long long) Size));
+
+    return t;
+}
+
+/// MIDI note to normalized phase increment at the sample rate (A4 = 440 Hz).
+template <size_t NumNotes>
+constexpr Table<NumNotes> makeDPhase(double sampleRate)
+{
+    Table<NumNotes> t;
+
+    for (size_t n = 0; n < NumNotes; ++n)
+        t[n] = float(440.0 * detail::semitones(int(n) - 69) / sampleRate);
+
+    return t;
+}
+
+/// MIDI velocity to gain curve, (v / (Size - 1))^1.5
+template <size_t Size>
+constexpr Table<Size> makeVelocityCurve()
+{
+    Table<Size> t;
+
+    for (size_t i = 0; i < Size; ++i) {
+        const double v = double(i) / double(Size - 1);
+        t[i] = float(v * detail::sqrt(v));
+    }
+
+    return t;
+}
+
+/// Sine table resolution, the table holds one period plus a guard point.
+constexpr size_t SINE_SIZE = LUT_SINE_SIZE;
+extern const float* const SINE;
+
+/// MIDI note to normalized phase increment.
+constexpr size_t NUM_NOTES = 128;
+extern const float* const DPHASE;
+
+/// MIDI velocity to gain curve.
+constexpr size_t VELOCITY_CURVE_SIZE = 128;
+extern const float* const VELOCITY_CURVE;
+
+} // namespace lut
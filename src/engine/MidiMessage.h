@@ -1,9 +1,16 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <array>
-#include "engine/FastList.h"
+#include <atomic>
 
-class MidiMessage : public ListItem<MidiMessage>
+/**
+ * @brief MIDI message packed into a single 32-bit word.
+ *
+ * Status byte in bits 16-23, data bytes in bits 8-15 and 0-7.
+ */
+class MidiMessage final
 {
 public:
     enum class Type
@@ -45,49 +52,240 @@ public:
 
 //==============================================================================
 
+static_assert(sizeof(MidiMessage) == sizeof(uint32_t), "MidiMessage must be packed into 32 bits");
+
+/**
+ * @brief MIDI message scheduled within an audio block.
+ */
+struct MidiEvent
+{
+    MidiMessage message;
+    uint32_t offset;    ///< Frame offset within the block.
+};
+
+/**
+ * @brief What MidiQueue does with a message pushed into the full queue.
+ */
+enum class MidiOverflow
+{
+    DropOldest, ///< Discard the oldest pending message.
+    DropNewest, ///< Discard the pushed message.
+    Coalesce    ///< Keep only the latest value of each controller, drop other messages.
+};
+
+/**
+ * @brief Lock-free single producer single consumer MIDI queue.
+ *
+ * push() is called from the main loop and pop() from the audio
+ * interrupt (or from two threads on the host). Messages are stored as
+ * packed 32-bit words, so that every slot is read and written atomically
+ * and neither side has to disable the other one.
+ *
+ * Every message carries the time stamp of its arrival, see
+ * Engine::process() for how it is used.
+ *
+ * The consumer claims a message by advancing the tail with a
+ * compare-and-swap, which lets the producer drop the oldest message
+ * when the queue is full. Coalesced controllers are kept in a separate
+ * latest-value table and delivered once the queue has been drained.
+ */
 template<size_t Size>
 class MidiQueue
 {
 public:
+
+    static_assert(Size > 0 && (Size & (Size - 1)) == 0, "Queue size must be a power of two");
+
+    constexpr static size_t SIZE = Size;
+    constexpr static size_t NUM_CONTROLLERS = 128;
+
     MidiQueue()
+        : m_head(0)
+        , m_tail(0)
+        , m_overflows(0)
+        , m_policy(MidiOverflow::Coalesce)
+        , m_lastTimestamp(0)
     {
-        for (auto& msg : m_allocatedMessages)
-            m_idleMessages.append(&msg);
+        for (auto& slot : m_slots)
+            slot.store(0, std::memory_order_relaxed);
+
+        for (auto& timestamp : m_timestamps)
+            timestamp.store(0, std::memory_order_relaxed);
+
+        for (auto& value : m_controllers)
+            value.store(0, std::memory_order_relaxed);
+
+        for (auto& bits : m_dirtyControllers)
+            bits.store(0, std::memory_order_relaxed);
     }
 
-    MidiMessage* allocate()
+    void setOverflowPolicy(MidiOverflow policy) { m_policy = policy; }
+    MidiOverflow overflowPolicy() const noexcept { return m_policy; }
+
+    /// Messages that have been dropped or coalesced due to the queue overflow.
+    uint32_t numOverflows() const noexcept { return m_overflows.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Append a message (producer side).
+     * @return false if the message has been dropped.
+     */
+    bool push(const MidiMessage& msg, uint32_t timestamp = 0)
     {
-        if (auto* msg = m_idleMessages.first()) {
-            m_idleMessages.remove(msg);
-            return msg;
+        const uint32_t head = m_head.load(std::memory_order_relaxed);
+        uint32_t tail = m_tail.load(std::memory_order_acquire);
+
+        if (m_policy == MidiOverflow::Coalesce && isController(msg)) {
+            // A pending coalesced value must not be overtaken
+            // by the same controller sent through the queue.
+            if (head - tail >= Size || isDirty(msg.cc())) {
+                coalesce(msg, head);
+                return true;
+            }
+        } else if (head - tail >= Size) {
+            if (m_policy != MidiOverflow::DropOldest) {
+                m_overflows.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+
+            // Fails only if the consumer has just made room.
+            if (m_tail.compare_exchange_strong(tail, tail + 1, std::memory_order_acq_rel))
+                m_overflows.fetch_add(1, std::memory_order_relaxed);
         }
 
-        return nullptr;
+        m_timestamps[head & mask].store(timestamp, std::memory_order_release);
+        m_slots[head & mask].store(msg.rawData, std::memory_order_release);
+        m_head.store(head + 1, std::memory_order_release);
+
+        return true;
     }
 
-    void push(MidiMessage* msg)
+    /**
+     * @brief Take the next message (consumer side).
+     * @return false if there are no pending messages.
+     */
+    bool pop(MidiMessage& msg)
     {
-        m_pendingMessages.append(msg);
+        uint32_t timestamp;
+        return pop(msg, timestamp);
     }
 
-    MidiMessage* next()
+    /**
+     * @brief Take the next message and its time stamp (consumer side).
+     *
+     * Coalesced controllers get the time stamp of the
+     * previously delivered message.
+     */
+    bool pop(MidiMessage& msg, uint32_t& timestamp)
     {
-        if (auto* msg = m_pendingMessages.first()) {
-            m_pendingMessages.remove(msg);
-            return msg;
+        uint32_t tail = m_tail.load(std::memory_order_acquire);
+
+        while (tail != m_head.load(std::memory_order_acquire)) {
+            const uint32_t data = m_slots[tail & mask].load(std::memory_order_acquire);
+            const uint32_t time = m_timestamps[tail & mask].load(std::memory_order_acquire);
+
+            // Fails if the producer has dropped this message meanwhile,
+            // the tail is then reloaded.
+            if (m_tail.compare_exchange_weak(tail, tail + 1, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                msg.rawData = data;
+                timestamp = m_lastTimestamp = time;
+                return true;
+            }
         }
 
-        return nullptr;
+        // Coalesced values are newer than anything left in the queue
+        // for the same controller.
+        timestamp = m_lastTimestamp;
+        return popController(msg);
     }
 
-    void recycle(MidiMessage* msg)
+private:
+
+    constexpr static uint32_t mask = Size - 1;
+    constexpr static size_t NUM_DIRTY_WORDS = NUM_CONTROLLERS / 32;
+
+    static bool isController(const MidiMessage& msg)
     {
-        msg->clear();
-        m_idleMessages.append(msg);
+        return msg.type() == MidiMessage::Type::ControlChange;
     }
 
-private:
-    std::array<MidiMessage, Size> m_allocatedMessages;
-    List<MidiMessage> m_idleMessages;
-    List<MidiMessage> m_pendingMessages;
+    // Coalesced controller entry: value in bits 0-6, channel in bits 8-11,
+    // queue position in bits 12-30, set until delivered in bit 31.
+    constexpr static uint32_t pendingFlag = 0x80000000;
+    constexpr static int positionShift = 12;
+    constexpr static uint32_t positionMask = 0x7FFFF;
+
+    bool isDirty(int cc) const
+    {
+        return (m_controllers[cc].load(std::memory_order_acquire) & pendingFlag) != 0;
+    }
+
+    void coalesce(const MidiMessage& msg, uint32_t head)
+    {
+        const int cc = msg.cc();
+        const uint32_t entry = pendingFlag
+                             | ((head & positionMask) << positionShift)
+                             | ((msg.rawData >> 8) & 0x0F00)
+                             | uint32_t(msg.value());
+
+        m_controllers[cc].store(entry, std::memory_order_release);
+        m_dirtyControllers[cc >> 5].fetch_or(1u << (cc & 31), std::memory_order_release);
+        m_overflows.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    bool popController(MidiMessage& msg)
+    {
+        const uint32_t tail = m_tail.load(std::memory_order_acquire);
+
+        for (size_t i = 0; i < NUM_DIRTY_WORDS; ++i) {
+            uint32_t bits = m_dirtyControllers[i].load(std::memory_order_acquire);
+
+            for (; bits != 0; bits &= bits - 1) {
+                const int cc = int(i * 32) + __builtin_ctz(bits);
+                const uint32_t bit = bits & (0u - bits);
+
+                // Cleared before looking at the value, so that an update
+                // made meanwhile sets it again.
+                m_dirtyControllers[i].fetch_and(~bit, std::memory_order_acq_rel);
+
+                auto& controller = m_controllers[cc];
+                uint32_t entry = controller.load(std::memory_order_acquire);
+
+                while ((entry & pendingFlag) != 0) {
+                    // The messages queued before this value
+                    // have to be delivered first.
+                    const uint32_t position = (entry >> positionShift) & positionMask;
+
+                    if (((tail - position) & positionMask) > (positionMask >> 1)) {
+                        m_dirtyControllers[i].fetch_or(bit, std::memory_order_relaxed);
+                        break;
+                    }
+
+                    // Fails if the producer has updated the value,
+                    // which is then checked again.
+                    if (controller.compare_exchange_weak(entry, 0, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                        msg.rawData = 0x00B00000 | ((entry & 0x0F00) << 8) | (uint32_t(cc) << 8) | (entry & 0x7F);
+                        return true;
+                    }
+                }
+            }
+        }
+
+        return false;
+    }
+
+    std::array<std::atomic<uint32_t>, Size> m_slots;
+    std::array<std::atomic<uint32_t>, Size> m_timestamps;
+    std::atomic<uint32_t> m_head;
+    std::atomic<uint32_t> m_tail;
+
+    std::atomic<uint32_t> m_overflows;
+    MidiOverflow m_policy;
+
+    // Latest value of coalesced controllers, the dirty bits
+    // tell which ones to look at.
+    std::array<std::atomic<uint32_t>, NUM_CONTROLLERS> m_controllers;
+    std::array<std::atomic<uint32_t>, NUM_DIRTY_WORDS> m_dirtyControllers;
+
+    // Consumer side
+    uint32_t m_lastTimestamp;
 };
@@ -4,93 +4,127 @@
 #include "Globals.h"
 #include "Parameter.h"
 
-Parameter::Parameter (float value,
-                      float min,
-                      float max,
-                      float smooth)
-    : m_currentValue (value)
-    , m_minValue (min)
-    , m_maxValue (max)
-    , m_targetValue (value)
-    , m_frac (smooth)
-    , m_smoothing (false)
-{
-}
+namespace {
+
+constexpr float DefaultSmoothing = 0.5f;
+
+} // anonymous namespace
 
 void Parameter::setValue (float v, float s, bool force)
 {
-    m_targetValue = math::clamp (m_minValue, m_maxValue, v);
-    m_frac = math::clamp (0.0f, 1.0f, s);
-
-    if (force) {
-        m_currentValue = m_targetValue;
-        m_smoothing = false;
-    } else {
-        updateSmoothing();
-    }  
+    setSmoothing (s);
+    setValue (v, force);
 }
 
 void Parameter::setValue (float v, bool force)
 {
-    m_targetValue = math::clamp (m_minValue, m_maxValue, v);
+    const float target = math::clamp (min(), max(), v);
+    m_pool.array (ParameterPool::Target)[m_index] = target;
 
     if (force) {
-        m_currentValue = m_targetValue;
-        m_smoothing = false;
-    } else {
-        updateSmoothing();
-    }   
+        // Jump to the value, including within the current block ramp.
+        m_pool.array (ParameterPool::Value)[m_index] = target;
+        m_pool.array (ParameterPool::Start)[m_index] = target;
+        m_pool.array (ParameterPool::Step)[m_index] = 0.0f;
+    }
 }
 
 void Parameter::setSmoothing (float s) noexcept
 {
-    m_frac = math::clamp (0.0f, 1.0f, s);
+    const float frac = math::clamp (0.0f, 1.0f, s);
+    m_pool.array (ParameterPool::Frac)[m_index] = frac;
+    m_pool.array (ParameterPool::BlockFrac)[m_index] = m_pool.blockFrac (frac);
 }
 
 void Parameter::setRange (float min, float max)
 {
-    m_minValue = std::min (min, max);
-    m_maxValue = std::max (min, max);
+    m_pool.array (ParameterPool::Min)[m_index] = std::min (min, max);
+    m_pool.array (ParameterPool::Max)[m_index] = std::max (min, max);
 }
 
 Parameter& Parameter::operator = (float v)
 {
-    setValue(v);
+    setValue (v);
 
     return *this;
 }
 
-float Parameter::nextValue()
+//==============================================================================
+
+ParameterPool::ParameterPool (size_t size, size_t framesPerStep)
+    : m_data (mem::allocate<float> (mem::Region::Fast, NumArrays * (size + 1)))
+    , m_size (size)
+    , m_stepsPerFrame (1.0f / float (framesPerStep))
+    , m_steps (1.0f)
+    , m_dummy {}
 {
-    if (m_smoothing)
-        m_currentValue = m_targetValue * m_frac + m_currentValue * (1.0f - m_frac);
+    if (m_data == nullptr) {
+        // Out of memory, all the indices refer to the dummy parameter.
+        m_data = m_dummy;
+        m_size = 0;
+    }
+
+    for (size_t i = 0; i <= m_size; ++i) {
+        array (Value)[i] = 0.0f;
+        array (Target)[i] = 0.0f;
+        array (Min)[i] = 0.0f;
+        array (Max)[i] = 1.0f;
+        array (Frac)[i] = DefaultSmoothing;
+        array (BlockFrac)[i] = DefaultSmoothing;
+        array (Start)[i] = 0.0f;
+        array (Step)[i] = 0.0f;
+    }
+}
 
-    updateSmoothing();
+Parameter ParameterPool::operator[] (int index)
+{
+    if (index >= 0 && index < (int) m_size)
+        return Parameter (*this, size_t (index));
 
-    return m_currentValue;
+    return Parameter (*this, m_size);
 }
 
-void Parameter::updateSmoothing()
+void ParameterPool::update (size_t numFrames)
 {
     constexpr float epsilon = 1e-6f;
 
-    m_smoothing = fabsf (m_currentValue - m_targetValue) > epsilon;
+    if (numFrames == 0)
+        return;
 
-    if (! m_smoothing)
-        m_currentValue = m_targetValue;
-}
+    const float steps = float (numFrames) * m_stepsPerFrame;
 
-//==============================================================================
+    if (steps != m_steps) {
+        // The block size has changed, the smoothing per block is cached.
+        m_steps = steps;
 
-ParameterPool::ParameterPool (size_t size)
-    : m_params (size)
-{
+        const float* frac = array (Frac);
+        float* blockFrac = array (BlockFrac);
+
+        for (size_t i = 0; i < m_size; ++i)
+            blockFrac[i] = this->blockFrac (frac[i]);
+    }
+
+    float* value = array (Value);
+    float* start = array (Start);
+    float* step = array (Step);
+    const float* target = array (Target);
+    const float* frac = array (BlockFrac);
+    const float scale = 1.0f / float (numFrames);
+
+    // No branches, so that the compiler can vectorize the loop.
+    for (size_t i = 0; i < m_size; ++i) {
+        const float v0 = value[i];
+        const float t = target[i];
+        const float v = t * frac[i] + v0 * (1.0f - frac[i]);
+        const float v1 = fabsf (v - t) > epsilon ? v : t;
+
+        start[i] = v0;
+        step[i] = (v1 - v0) * scale;
+        value[i] = v1;
+    }
 }
 
-Parameter& ParameterPool::operator[] (int index)
+float ParameterPool::blockFrac (float frac) const
 {
-    if (index >= 0 && index < (int) m_params.size())
-        return m_params.at (index);
-
-    return m_dummyParameter;
+    return m_steps == 1.0f ? frac : 1.0f - powf (1.0f - frac, m_steps);
 }
@@ -1,19 +1,38 @@
 #pragma once
 
-#include <vector>
+#include <cstddef>
+#include "engine/Arena.h"
+
+class ParameterPool;
+
+/**
+ * Linear ramp of a parameter over the last updated block.
+ */
+struct ParameterRamp
+{
+    float start;    // Value at the end of the previous block
+    float step;     // Increment per frame
+
+    bool isConstant() const noexcept { return step == 0.0f; }
+
+    /// Value at the frame, the last frame of the block gets the block value.
+    float operator[] (size_t frame) const noexcept { return start + step * float (frame + 1); }
+};
+
+//----------------------------------------------------------
 
 /**
- * Parameter with smoothed float value.
+ * Reference to a smoothed float parameter of a pool.
  */
 class Parameter
 {
 public:
 
-    Parameter (float value = 0.0f,
-               float min = 0.0f,
-               float max = 1.0f,
-               float smooth = 0.5f);
-    
+    Parameter (ParameterPool& pool, size_t index) noexcept
+        : m_pool (pool)
+        , m_index (index)
+    {}
+
     void setValue (float v, float s, bool force = false);
     void setValue (float v, bool force = false);
     void setSmoothing (float s) noexcept;
@@ -21,38 +40,86 @@ public:
 
     Parameter& operator = (float v);
 
-    float value() const noexcept      { return m_currentValue; }
-    float target() const noexcept     { return m_targetValue; }
-    float min() const noexcept        { return m_minValue; }
-    float max() const noexcept        { return m_maxValue; }
-    bool isSmoothing() const noexcept { return m_smoothing || m_currentValue != m_targetValue; }
-
-    float nextValue();
-
-    float& targetRef() noexcept { return m_targetValue; }
+    inline float value() const noexcept;
+    inline float target() const noexcept;
+    inline float min() const noexcept;
+    inline float max() const noexcept;
+    inline bool isSmoothing() const noexcept;
+    inline ParameterRamp ramp() const noexcept;
 
 private:
-
-    void updateSmoothing();
-
-    float m_currentValue;
-    float m_minValue;
-    float m_maxValue;
-    float m_targetValue;
-    float m_frac;
-    bool  m_smoothing;
+    ParameterPool& m_pool;
+    size_t m_index;
 };
 
 //----------------------------------------------------------
 
+/**
+ * Fixed number of smoothed parameters, stored as structure of arrays
+ * allocated from the fast memory arena.
+ *
+ * Targets can be set at any time. Once per block update() advances the
+ * one-pole smoothing of all the parameters at once, and each parameter
+ * gets a linear ramp over the block, from its previous block value to
+ * the new one. DSP code reads the ramps (or the block values) instead
+ * of smoothing every sample.
+ *
+ * The smoothing factor applies to steps of framesPerStep frames,
+ * so the smoothing time does not depend on the block size.
+ */
 class ParameterPool
 {
 public:
-    ParameterPool (size_t size);
-    size_t size() const { return m_params.size(); }
-    Parameter& operator[] (int index);
+    ParameterPool (size_t size, size_t framesPerStep = 1);
+    ParameterPool (const ParameterPool&) = delete;
+    ParameterPool& operator = (const ParameterPool&) = delete;
+
+    size_t size() const { return m_size; }
+
+    /// Out of range indices refer to a dummy parameter.
+    Parameter operator[] (int index);
+
+    /// Advance the smoothing of all the parameters by a block of frames.
+    void update (size_t numFrames);
 
 private:
-    std::vector<Parameter> m_params;
-    Parameter m_dummyParameter;
+
+    friend class Parameter;
+
+    enum Array
+    {
+        Value = 0,
+        Target,
+        Min,
+        Max,
+        Frac,       // Smoothing per step
+        BlockFrac,  // Smoothing per block of m_steps
+        Start,
+        Step,
+
+        NumArrays
+    };
+
+    float blockFrac (float frac) const;
+
+    float* array (Array a) const noexcept { return m_data + size_t (a) * (m_size + 1); }
+
+    float* m_data;
+    size_t m_size;
+    float m_stepsPerFrame;
+    float m_steps;
+    float m_dummy[NumArrays];
 };
+
+//----------------------------------------------------------
+
+float Parameter::value() const noexcept        { return m_pool.array (ParameterPool::Value)[m_index]; }
+float Parameter::target() const noexcept       { return m_pool.array (ParameterPool::Target)[m_index]; }
+float Parameter::min() const noexcept          { return m_pool.array (ParameterPool::Min)[m_index]; }
+float Parameter::max() const noexcept          { return m_pool.array (ParameterPool::Max)[m_index]; }
+bool Parameter::isSmoothing() const noexcept   { return value() != target(); }
+
+ParameterRamp Parameter::ramp() const noexcept
+{
+    return { m_pool.array (ParameterPool::Start)[m_index], m_pool.array (ParameterPool::Step)[m_index] };
+}
@@ -0,0 +1,138 @@
+#include "engine/Profiler.h"
+
+#if defined(ENGINE_PROFILING)
+
+#include <cstdio>
+#include "engine/Globals.h"
+
+namespace perf {
+
+static const char* stageName(int stage)
+{
+    switch (stage)
+    {
+        case Profiler::Block:      return "block";
+        case Profiler::Midi:       return "midi";
+        case Profiler::Voices:     return "voices";
+        case Profiler::Voice:      return "  per voice";
+        case Profiler::Parameters: return "parameters";
+        case Profiler::Convert:    return "convert";
+        default: break;
+    }
+
+    return "effect";
+}
+
+void Profiler::Stats::reset()
+{
+    min = 0;
+    max = 0;
+    total = 0;
+    count = 0;
+}
+
+void Profiler::Stats::add(CycleCounter::Ticks t)
+{
+    if (count == 0 || t < min)
+        min = t;
+
+    if (t > max)
+        max = t;
+
+    total += t;
+    ++count;
+}
+
+float Profiler::Stats::average() const
+{
+    return count > 0 ? float(total) / float(count) : 0.0f;
+}
+
+//==============================================================================
+
+Profiler::Profiler()
+{
+    reset();
+}
+
+void Profiler::reset()
+{
+    for (auto& s : m_stats)
+        s.reset();
+
+    for (auto& bin : m_histogram)
+        bin = 0;
+
+    m_missedDeadlines = 0;
+    m_deadline = CycleCounter::Ticks(CycleCounter::ticksPerSecond() * globals::AUDIO_BLOCK_SIZE * globals::SAMPLE_RATE_R);
+}
+
+void Profiler::record(int stage, CycleCounter::Ticks t)
+{
+    m_stats[stage].add(t);
+}
+
+void Profiler::recordBlock(CycleCounter::Ticks t)
+{
+    m_stats[Block].add(t);
+
+    if (t > m_deadline) {
+        ++m_missedDeadlines;
+        ++m_histogram[NumHistogramBins - 1];
+    } else {
+        const int bin = int((NumHistogramBins - 1) * uint64_t(t) / (uint64_t(m_deadline) + 1));
+        ++m_histogram[bin];
+    }
+}
+
+void Profiler::report(PrintFunc print) const
+{
+    char line[96];
+    const float us = 1e6f / CycleCounter::ticksPerSecond();
+
+    snprintf(line, sizeof(line), "%-14s %10s %10s %10s %10s", "stage", "min [us]", "avg [us]", "max [us]", "count");
+    print(line);
+
+    for (int stage = 0; stage < NumStages; ++stage) {
+        const auto& s = m_stats[stage];
+
+        if (s.count == 0)
+            continue;
+
+        char name[16];
+
+        if (stage >= Effect)
+            snprintf(name, sizeof(name), "effect %d", stage - Effect);
+        else
+            snprintf(name, sizeof(name), "%s", stageName(stage));
+
+        snprintf(line, sizeof(line), "%-14s %10.2f %10.2f %10.2f %10u",
+                 name, s.min * us, s.average() * us, s.max * us, (unsigned) s.count);
+        print(line);
+    }
+
+    print("block time histogram [% of deadline]:");
+
+    for (int bin = 0; bin < NumHistogramBins; ++bin) {
+        if (bin < NumHistogramBins - 1)
+            snprintf(line, sizeof(line), "  %3d-%3d%% %10u", bin * 10, bin * 10 + 10, (unsigned) m_histogram[bin]);
+        else
+            snprintf(line, sizeof(line), "    >100%% %10u", (unsigned) m_histogram[bin]);
+
+        print(line);
+    }
+
+    snprintf(line, sizeof(line), "missed deadlines: %u of %u blocks",
+             (unsigned) m_missedDeadlines, (unsigned) m_stats[Block].count);
+    print(line);
+}
+
+Profiler& Profiler::instance()
+{
+    static Profiler profiler;
+    return profiler;
+}
+
+} // namespace perf
+
+#endif // ENGINE_PROFILING
@@ -0,0 +1,118 @@
+#pragma once
+
+/*
+ * Per-stage DSP profiler.
+ *
+ * Enabled by defining ENGINE_PROFILING, otherwise all the PROFILE_*
+ * macros expand to nothing and the profiler is compiled out entirely.
+ */
+
+#if defined(ENGINE_PROFILING)
+
+#include <cstdint>
+#include <cstddef>
+#include "engine/CycleCounter.h"
+
+namespace perf {
+
+using PrintFunc = void (*)(const char* line);
+
+/**
+ * @brief Collects timing statistics of the audio processing stages.
+ *
+ * Time is measured in CycleCounter ticks (CPU cycles on the device).
+ */
+class Profiler
+{
+public:
+
+    constexpr static int MaxEffects = 8;
+
+    enum Stage
+    {
+        Block = 0,  // Whole audio block, from update() entry to exit
+        Midi,       // Queued MIDI messages processing
+        Voices,     // All active voices
+        Voice,      // Single voice (one record per active voice)
+        Parameters, // Parameters update
+        Convert,    // Float to integer output conversion
+        Effect,     // First effect in the chain, followed by MaxEffects - 1 more
+
+        NumStages = Effect + MaxEffects
+    };
+
+    // Block time histogram, bins are 10% of the block deadline wide.
+    // The last bin collects all the blocks that missed the deadline.
+    constexpr static int NumHistogramBins = 11;
+
+    struct Stats
+    {
+        CycleCounter::Ticks min;
+        CycleCounter::Ticks max;
+        uint64_t total;
+        uint32_t count;
+
+        void reset();
+        void add(CycleCounter::Ticks t);
+        float average() const;
+    };
+
+    Profiler();
+
+    void reset();
+
+    void record(int stage, CycleCounter::Ticks t);
+    void recordBlock(CycleCounter::Ticks t);
+
+    const Stats& stats(int stage) const { return m_stats[stage]; }
+    uint32_t histogram(int bin) const { return m_histogram[bin]; }
+    uint32_t missedDeadlines() const { return m_missedDeadlines; }
+
+    void report(PrintFunc print) const;
+
+    static Profiler& instance();
+
+private:
+
+    Stats m_stats[NumStages];
+    uint32_t m_histogram[NumHistogramBins];
+    uint32_t m_missedDeadlines;
+    CycleCounter::Ticks m_deadline;
+};
+
+/**
+ * @brief Records the time spent in the enclosing scope.
+ */
+class ProfileScope
+{
+public:
+    explicit ProfileScope(int stage)
+        : m_stage(stage)
+        , m_start(CycleCounter::now())
+    {
+    }
+
+    ~ProfileScope()
+    {
+        Profiler::instance().record(m_stage, CycleCounter::since(m_start));
+    }
+
+private:
+    int m_stage;
+    CycleCounter::Ticks m_start;
+};
+
+} // namespace perf
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+#define PROFILE_SCOPE(stage) ::perf::ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(stage)
+#define PROFILE_BLOCK(ticks) ::perf::Profiler::instance().recordBlock(ticks)
+
+#else
+
+#define PROFILE_SCOPE(stage)
+#define PROFILE_BLOCK(ticks)
+
+#endif // ENGINE_PROFILING
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include "engine/Globals.h"
+
+/**
+ * @brief Trades rendering quality for DSP load.
+ *
+ * Fed with the load of every block, steps the quality level up
+ * (lower quality) while the load is above the degrade threshold and
+ * back down once the load has stayed below the restore threshold
+ * for a while. Level 0 is the full quality, what every level
+ * reduces is up to the instrument, see FmInstrumentBase::setQuality().
+ */
+class QualityGovernor final
+{
+public:
+
+    constexpr static int MAX_LEVEL = 4;
+
+    struct Settings
+    {
+        bool enabled = true;
+
+        /// Load (percent) above which the quality gets reduced.
+        float degradeLoad = 85.0f;
+
+        /// Load (percent) below which the quality gets restored.
+        float restoreLoad = 50.0f;
+
+        /// Blocks between two reductions, for the load to reflect the last one.
+        uint32_t degradeBlocks = 8;
+
+        /// Blocks the load must stay below restoreLoad for every restored level (1 second).
+        uint32_t restoreBlocks = uint32_t(globals::SAMPLE_RATE / globals::AUDIO_BLOCK_SIZE);
+    };
+
+    QualityGovernor()
+        : m_level(0)
+        , m_maxLevel(MAX_LEVEL)
+        , m_blocksSinceChange(0)
+        , m_lowLoadBlocks(0)
+    {
+    }
+
+    void setSettings(const Settings& settings) { m_settings = settings; }
+
+    /// Lowest quality the instrument has, up to MAX_LEVEL.
+    void setMaxLevel(int level) { m_maxLevel = level < MAX_LEVEL ? level : MAX_LEVEL; }
+    int maxLevel() const noexcept { return m_maxLevel; }
+    const Settings& settings() const noexcept { return m_settings; }
+
+    int level() const noexcept { return m_level; }
+
+    /// Account for the load of a block, returns true if the level has changed.
+    bool update(float loadPercent)
+    {
+        int level = m_level;
+
+        if (m_blocksSinceChange < m_settings.degradeBlocks)
+            m_blocksSinceChange += 1;
+
+        if (! m_settings.enabled) {
+            level = 0;
+        } else if (loadPercent > m_settings.degradeLoad) {
+            m_lowLoadBlocks = 0;
+
+            if (m_blocksSinceChange >= m_settings.degradeBlocks && level < m_maxLevel)
+                level += 1;
+        } else if (loadPercent < m_settings.restoreLoad) {
+            if (++m_lowLoadBlocks >= m_settings.restoreBlocks && level > 0)
+                level -= 1;
+        } else {
+            m_lowLoadBlocks = 0;
+        }
+
+        if (level == m_level)
+            return false;
+
+        m_level = level;
+        m_blocksSinceChange = 0;
+        m_lowLoadBlocks = 0;
+
+        return true;
+    }
+
+private:
+
+    Settings m_settings;
+
+    int m_level;
+    int m_maxLevel;
+    uint32_t m_blocksSinceChange;
+    uint32_t m_lowLoadBlocks;
+};
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include "engine/Globals.h"
+
+/**
+ * @brief Ring of blocks rendered ahead of time.
+ *
+ * A lower priority context keeps up to latency() blocks rendered while
+ * the audio interrupt only takes the oldest finished one, so that a
+ * block taking longer than the block period to render does not cause
+ * a glitch as long as the ring does not run dry.
+ *
+ * Single producer (renderer) and single consumer (audio interrupt).
+ */
+
+/// Rendered block in the audio library layout, separate 16-bit channels.
+struct RenderAheadBlock
+{
+    int16_t left[globals::AUDIO_BLOCK_SIZE];
+    int16_t right[globals::AUDIO_BLOCK_SIZE];
+};
+
+template <size_t MaxBlocks, typename BlockType = RenderAheadBlock>
+class RenderAhead final
+{
+public:
+
+    static_assert(MaxBlocks > 0 && (MaxBlocks & (MaxBlocks - 1)) == 0, "Ring size must be a power of two");
+
+    constexpr static size_t MAX_BLOCKS = MaxBlocks;
+
+    using Block = BlockType;
+
+    RenderAhead()
+        : m_head(0)
+        , m_tail(0)
+        , m_latency(MaxBlocks)
+        , m_minReadyBlocks(MaxBlocks)
+        , m_numUnderruns(0)
+    {
+    }
+
+    /// Set the number of blocks rendered ahead (1 to MaxBlocks), discards the rendered ones.
+    void setLatency(size_t numBlocks)
+    {
+        m_latency = numBlocks < 1 ? 1 : (numBlocks > MaxBlocks ? MaxBlocks : numBlocks);
+        m_tail.store(m_head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        resetStats();
+    }
+
+    size_t latency() const noexcept { return m_latency; }
+
+    /// Block to render next, nullptr if the ring is full (renderer side).
+    Block* nextToRender()
+    {
+        const uint32_t head = m_head.load(std::memory_order_relaxed);
+
+        if (head - m_tail.load(std::memory_order_acquire) >= m_latency)
+            return nullptr;
+
+        return &m_blocks[head & mask];
+    }
+
+    /// Publish the block returned by nextToRender().
+    void rendered()
+    {
+        m_head.store(m_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /// Oldest rendered block, nullptr if the ring has run dry (audio interrupt side).
+    const Block* nextToPlay()
+    {
+        const uint32_t ready = m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_relaxed);
+
+        if (ready < m_minReadyBlocks.load(std::memory_order_relaxed))
+            m_minReadyBlocks.store(ready, std::memory_order_relaxed);
+
+        if (ready == 0) {
+            m_numUnderruns.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        return &m_blocks[m_tail.load(std::memory_order_relaxed) & mask];
+    }
+
+    /// Release the block returned by nextToPlay() for rendering.
+    void played()
+    {
+        m_tail.store(m_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /// Fewest rendered blocks found by nextToPlay() since the last reset.
+    size_t minReadyBlocks() const noexcept { return m_minReadyBlocks.load(std::memory_order_relaxed); }
+
+    /// Blocks played as silence because the ring has run dry.
+    uint32_t numUnderruns() const noexcept { return m_numUnderruns.load(std::memory_order_relaxed); }
+
+    void resetStats()
+    {
+        m_minReadyBlocks.store(m_latency, std::memory_order_relaxed);
+        m_numUnderruns.store(0, std::memory_order_relaxed);
+    }
+
+private:
+
+    constexpr static uint32_t mask = MaxBlocks - 1;
+
+    Block m_blocks[MaxBlocks];
+
+    std::atomic<uint32_t> m_head;
+    std::atomic<uint32_t> m_tail;
+
+    size_t m_latency;
+
+    std::atomic<uint32_t> m_minReadyBlocks;
+    std::atomic<uint32_t> m_numUnderruns;
+};
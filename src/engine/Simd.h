@@ -0,0 +1,288 @@
+#pragma once
+
+#include <cstdint>
+
+#if defined(__SSE2__)
+#   include <emmintrin.h>
+#   define SIMD_SSE2 1
+#elif defined(__ARM_NEON)
+#   include <arm_neon.h>
+#   define SIMD_NEON 1
+#else
+#   define SIMD_SCALAR 1
+#endif
+
+/**
+ * Minimal 4-lane float vector used by the voice bank
+ * and the output conversion, plus the bit operations
+ * of the output dither generator.
+ *
+ * Maps onto SSE2 on the host and NEON where available.
+ * Cortex-M7 has no floating point SIMD, there the scalar
+ * fallback is used, which keeps the same data layout
+ * and lets the compiler schedule the four lanes.
+ */
+namespace simd {
+
+constexpr int LANES = 4;
+
+#if SIMD_SSE2
+
+struct float4
+{
+    __m128 v;
+
+    float4() = default;
+    float4(__m128 x) : v(x) {}
+    explicit float4(float x) : v(_mm_set1_ps(x)) {}
+
+    static float4 load(const float* p) { return _mm_load_ps(p); }
+    void store(float* p) const { _mm_store_ps(p, v); }
+};
+
+inline float4 operator + (float4 a, float4 b) { return _mm_add_ps(a.v, b.v); }
+inline float4 operator - (float4 a, float4 b) { return _mm_sub_ps(a.v, b.v); }
+inline float4 operator * (float4 a, float4 b) { return _mm_mul_ps(a.v, b.v); }
+
+inline float4 max(float4 a, float4 b) { return _mm_max_ps(a.v, b.v); }
+inline float4 min(float4 a, float4 b) { return _mm_min_ps(a.v, b.v); }
+inline float4 abs(float4 a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a.v); }
+
+/// Round towards zero.
+inline float4 trunc(float4 a) { return _mm_cvtepi32_ps(_mm_cvttps_epi32(a.v)); }
+
+/// Truncated integer lanes.
+inline void toInt(float4 a, int32_t* p) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm_cvttps_epi32(a.v)); }
+
+/// Truncated and saturated 16-bit integer lanes.
+inline void toInt16(float4 a, int16_t* p)
+{
+    const __m128i i = _mm_cvttps_epi32(a.v);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(p), _mm_packs_epi32(i, i));
+}
+
+/// Same as toInt16(), the lanes of a and b interleaved: a0 b0 a1 b1 ...
+inline void toInt16Interleaved(float4 a, float4 b, int16_t* p)
+{
+    const __m128i ia = _mm_cvttps_epi32(a.v);
+    const __m128i ib = _mm_cvttps_epi32(b.v);
+    const __m128i i = _mm_packs_epi32(_mm_unpacklo_epi32(ia, ib), _mm_unpackhi_epi32(ia, ib));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p), i);
+}
+
+/// Same as toInt(), the lanes of a and b interleaved: a0 b0 a1 b1 ...
+inline void toIntInterleaved(float4 a, float4 b, int32_t* p)
+{
+    const __m128i ia = _mm_cvttps_epi32(a.v);
+    const __m128i ib = _mm_cvttps_epi32(b.v);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm_unpacklo_epi32(ia, ib));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p + 4), _mm_unpackhi_epi32(ia, ib));
+}
+
+/// Bit mask of the lanes where a >= b.
+inline int greaterEqual(float4 a, float4 b) { return _mm_movemask_ps(_mm_cmpge_ps(a.v, b.v)); }
+
+inline float sum(float4 a)
+{
+    const __m128 h = _mm_add_ps(a.v, _mm_movehl_ps(a.v, a.v));
+    return _mm_cvtss_f32(_mm_add_ss(h, _mm_shuffle_ps(h, h, 1)));
+}
+
+/// 4-lane unsigned integer vector, bit operations only.
+struct uint4
+{
+    __m128i v;
+
+    uint4() = default;
+    uint4(__m128i x) : v(x) {}
+    explicit uint4(uint32_t x) : v(_mm_set1_epi32(int32_t(x))) {}
+
+    static uint4 load(const uint32_t* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+    void store(uint32_t* p) const { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+};
+
+inline uint4 operator ^ (uint4 a, uint4 b) { return _mm_xor_si128(a.v, b.v); }
+inline uint4 operator & (uint4 a, uint4 b) { return _mm_and_si128(a.v, b.v); }
+inline uint4 operator | (uint4 a, uint4 b) { return _mm_or_si128(a.v, b.v); }
+
+template <int N> inline uint4 shiftLeft(uint4 a) { return _mm_slli_epi32(a.v, N); }
+template <int N> inline uint4 shiftRight(uint4 a) { return _mm_srli_epi32(a.v, N); }
+
+/// Reinterpret the bits.
+inline float4 asFloat(uint4 a) { return _mm_castsi128_ps(a.v); }
+inline uint4 asUint(float4 a) { return _mm_castps_si128(a.v); }
+
+#elif SIMD_NEON
+
+struct float4
+{
+    float32x4_t v;
+
+    float4() = default;
+    float4(float32x4_t x) : v(x) {}
+    explicit float4(float x) : v(vdupq_n_f32(x)) {}
+
+    static float4 load(const float* p) { return vld1q_f32(p); }
+    void store(float* p) const { vst1q_f32(p, v); }
+};
+
+inline float4 operator + (float4 a, float4 b) { return vaddq_f32(a.v, b.v); }
+inline float4 operator - (float4 a, float4 b) { return vsubq_f32(a.v, b.v); }
+inline float4 operator * (float4 a, float4 b) { return vmulq_f32(a.v, b.v); }
+
+inline float4 max(float4 a, float4 b) { return vmaxq_f32(a.v, b.v); }
+inline float4 min(float4 a, float4 b) { return vminq_f32(a.v, b.v); }
+inline float4 abs(float4 a) { return vabsq_f32(a.v); }
+
+inline float4 trunc(float4 a) { return vcvtq_f32_s32(vcvtq_s32_f32(a.v)); }
+
+inline void toInt(float4 a, int32_t* p) { vst1q_s32(p, vcvtq_s32_f32(a.v)); }
+
+inline void toInt16(float4 a, int16_t* p) { vst1_s16(p, vqmovn_s32(vcvtq_s32_f32(a.v))); }
+
+inline void toInt16Interleaved(float4 a, float4 b, int16_t* p)
+{
+    const int16x4x2_t i = { { vqmovn_s32(vcvtq_s32_f32(a.v)), vqmovn_s32(vcvtq_s32_f32(b.v)) } };
+    vst2_s16(p, i);
+}
+
+inline void toIntInterleaved(float4 a, float4 b, int32_t* p)
+{
+    const int32x4x2_t i = { { vcvtq_s32_f32(a.v), vcvtq_s32_f32(b.v) } };
+    vst2q_s32(p, i);
+}
+
+inline int greaterEqual(float4 a, float4 b)
+{
+    static const int32_t bits[4] = { 1, 2, 4, 8 };
+    const uint32x4_t m = vandq_u32(vcgeq_f32(a.v, b.v), vreinterpretq_u32_s32(vld1q_s32(bits)));
+    const uint32x2_t h = vadd_u32(vget_low_u32(m), vget_high_u32(m));
+    return int(vget_lane_u32(vpadd_u32(h, h), 0));
+}
+
+inline float sum(float4 a)
+{
+    const float32x2_t h = vadd_f32(vget_low_f32(a.v), vget_high_f32(a.v));
+    return vget_lane_f32(vpadd_f32(h, h), 0);
+}
+
+struct uint4
+{
+    uint32x4_t v;
+
+    uint4() = default;
+    uint4(uint32x4_t x) : v(x) {}
+    explicit uint4(uint32_t x) : v(vdupq_n_u32(x)) {}
+
+    static uint4 load(const uint32_t* p) { return vld1q_u32(p); }
+    void store(uint32_t* p) const { vst1q_u32(p, v); }
+};
+
+inline uint4 operator ^ (uint4 a, uint4 b) { return veorq_u32(a.v, b.v); }
+inline uint4 operator & (uint4 a, uint4 b) { return vandq_u32(a.v, b.v); }
+inline uint4 operator | (uint4 a, uint4 b) { return vorrq_u32(a.v, b.v); }
+
+template <int N> inline uint4 shiftLeft(uint4 a) { return vshlq_n_u32(a.v, N); }
+template <int N> inline uint4 shiftRight(uint4 a) { return vshrq_n_u32(a.v, N); }
+
+inline float4 asFloat(uint4 a) { return vreinterpretq_f32_u32(a.v); }
+inline uint4 asUint(float4 a) { return vreinterpretq_u32_f32(a.v); }
+
+#else // SIMD_SCALAR
+
+struct float4
+{
+    float v[LANES];
+
+    float4() = default;
+    explicit float4(float x) : v{x, x, x, x} {}
+
+    static float4 load(const float* p)
+    {
+        float4 r;
+        for (int i = 0; i < LANES; ++i) r.v[i] = p[i];
+        return r;
+    }
+
+    void store(float* p) const
+    {
+        for (int i = 0; i < LANES; ++i) p[i] = v[i];
+    }
+};
+
+inline float4 operator + (float4 a, float4 b) { for (int i = 0; i < LANES; ++i) a.v[i] += b.v[i]; return a; }
+inline float4 operator - (float4 a, float4 b) { for (int i = 0; i < LANES; ++i) a.v[i] -= b.v[i]; return a; }
+inline float4 operator * (float4 a, float4 b) { for (int i = 0; i < LANES; ++i) a.v[i] *= b.v[i]; return a; }
+
+inline float4 max(float4 a, float4 b) { for (int i = 0; i < LANES; ++i) a.v[i] = a.v[i] > b.v[i] ? a.v[i] : b.v[i]; return a; }
+inline float4 min(float4 a, float4 b) { for (int i = 0; i < LANES; ++i) a.v[i] = a.v[i] < b.v[i] ? a.v[i] : b.v[i]; return a; }
+inline float4 abs(float4 a) { for (int i = 0; i < LANES; ++i) a.v[i] = __builtin_fabsf(a.v[i]); return a; }
+
+inline float4 trunc(float4 a) { for (int i = 0; i < LANES; ++i) a.v[i] = float(int32_t(a.v[i])); return a; }
+
+inline void toInt(float4 a, int32_t* p) { for (int i = 0; i < LANES; ++i) p[i] = int32_t(a.v[i]); }
+
+inline int16_t saturate16(int32_t x) { return int16_t(x < -32768 ? -32768 : (x > 32767 ? 32767 : x)); }
+
+inline void toInt16(float4 a, int16_t* p) { for (int i = 0; i < LANES; ++i) p[i] = saturate16(int32_t(a.v[i])); }
+
+inline void toInt16Interleaved(float4 a, float4 b, int16_t* p)
+{
+    for (int i = 0; i < LANES; ++i) {
+        p[2 * i]     = saturate16(int32_t(a.v[i]));
+        p[2 * i + 1] = saturate16(int32_t(b.v[i]));
+    }
+}
+
+inline void toIntInterleaved(float4 a, float4 b, int32_t* p)
+{
+    for (int i = 0; i < LANES; ++i) {
+        p[2 * i]     = int32_t(a.v[i]);
+        p[2 * i + 1] = int32_t(b.v[i]);
+    }
+}
+
+inline int greaterEqual(float4 a, float4 b)
+{
+    int mask = 0;
+    for (int i = 0; i < LANES; ++i) mask |= (a.v[i] >= b.v[i]) << i;
+    return mask;
+}
+
+inline float sum(float4 a) { return (a.v[0] + a.v[1]) + (a.v[2] + a.v[3]); }
+
+struct uint4
+{
+    uint32_t v[LANES];
+
+    uint4() = default;
+    explicit uint4(uint32_t x) : v{x, x, x, x} {}
+
+    static uint4 load(const uint32_t* p)
+    {
+        uint4 r;
+        for (int i = 0; i < LANES; ++i) r.v[i] = p[i];
+        return r;
+    }
+
+    void store(uint32_t* p) const
+    {
+        for (int i = 0; i < LANES; ++i) p[i] = v[i];
+    }
+};
+
+inline uint4 operator ^ (uint4 a, uint4 b) { for (int i = 0; i < LANES; ++i) a.v[i] ^= b.v[i]; return a; }
+inline uint4 operator & (uint4 a, uint4 b) { for (int i = 0; i < LANES; ++i) a.v[i] &= b.v[i]; return a; }
+inline uint4 operator | (uint4 a, uint4 b) { for (int i = 0; i < LANES; ++i) a.v[i] |= b.v[i]; return a; }
+
+template <int N> inline uint4 shiftLeft(uint4 a) { for (int i = 0; i < LANES; ++i) a.v[i] <<= N; return a; }
+template <int N> inline uint4 shiftRight(uint4 a) { for (int i = 0; i < LANES; ++i) a.v[i] >>= N; return a; }
+
+inline float4 asFloat(uint4 a) { float4 r; __builtin_memcpy(r.v, a.v, sizeof(r.v)); return r; }
+inline uint4 asUint(float4 a) { uint4 r; __builtin_memcpy(r.v, a.v, sizeof(r.v)); return r; }
+
+#endif
+
+inline float4& operator += (float4& a, float4 b) { a = a + b; return a; }
+
+} // namespace simd
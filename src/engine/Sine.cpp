@@ -0,0 +1,8 @@
+#include "engine/Sine.h"
+
+namespace sine {
+
+// Generated at compile time, no initialization before the audio starts.
+lut::Table<QUARTER_SIZE + 4> quarterTable = lut::makeQuarterSine<QUARTER_SIZE>();
+
+} // namespace sine
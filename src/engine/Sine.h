@@ -0,0 +1,168 @@
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+#include <cstring>
+#include "engine/Globals.h"
+#include "engine/Lut.h"
+
+/**
+ * Sine oscillator kernels.
+ *
+ * All the kernels take a 32-bit fixed point phase, a fraction of the
+ * period that wraps naturally. SINE_KERNEL selects the one sineLUT()
+ * uses, the others remain available for the benchmarks.
+ */
+#define SINE_KERNEL_TABLE           0   // Full period table, no interpolation
+#define SINE_KERNEL_QUARTER         1   // Quarter-wave table, no interpolation
+#define SINE_KERNEL_QUARTER_LINEAR  2   // Quarter-wave table, linear interpolation
+#define SINE_KERNEL_QUARTER_CUBIC   3   // Quarter-wave table, 4-point Lagrange interpolation
+#define SINE_KERNEL_POLYNOMIAL      4   // 7th order polynomial, no table
+
+// The interpolated kernels cost about twice as much per operator,
+// the default keeps the cost of the full period table.
+#ifndef SINE_KERNEL
+#   define SINE_KERNEL SINE_KERNEL_TABLE
+#endif
+
+// The selected kernel interpolates, fastSineLUT() is only cheaper then.
+#define SINE_KERNEL_INTERPOLATES (SINE_KERNEL == SINE_KERNEL_QUARTER_LINEAR || SINE_KERNEL == SINE_KERNEL_QUARTER_CUBIC)
+
+// Quarter-wave table resolution
+#ifndef SINE_QUARTER_BITS
+#   define SINE_QUARTER_BITS 10
+#endif
+
+namespace sine {
+
+constexpr int QUARTER_BITS = SINE_QUARTER_BITS;
+constexpr size_t QUARTER_SIZE = 1 << QUARTER_BITS;
+
+/**
+ * See lut::makeQuarterSine().
+ *
+ * Not const, so that on Teensy it lives in DTCM rather than in flash.
+ */
+extern lut::Table<QUARTER_SIZE + 4> quarterTable;
+
+constexpr int log2(size_t n) { return n <= 1 ? 0 : 1 + log2(n / 2); }
+
+/// Phase in periods, wrapped to (-1, 1) then converted to fixed point.
+inline uint32_t toPhase(float p)
+{
+    const float w = p - float(int32_t(p));
+    return uint32_t(int32_t(w * 2147483648.0f)) << 1;
+}
+
+inline float table(uint32_t phase)
+{
+    constexpr int indexBits = log2(lut::SINE_SIZE);
+
+    return lut::SINE[phase >> (32 - indexBits)];
+}
+
+/**
+ * @brief Folds the phase onto the first quadrant, branch-free.
+ *
+ * Returns the position within the quadrant in 2^-30 units,
+ * 2nd and 4th quadrants are mirrored.
+ */
+inline uint32_t fold(uint32_t phase)
+{
+    const uint32_t mirror = 0u - ((phase >> 30) & 1u);
+    const uint32_t x = phase & 0x3fffffffu;
+
+    // x or 2^30 - x
+    return (x ^ mirror) + (mirror & 0x40000001u);
+}
+
+/// Negates the value in the 2nd half of the period.
+inline float applySign(float value, uint32_t phase)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    bits ^= phase & 0x80000000u;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+constexpr int FRAC_BITS = 30 - QUARTER_BITS;
+constexpr float FRAC_SCALE = 1.0f / float(1u << FRAC_BITS);
+
+inline float quarter(uint32_t phase)
+{
+    const uint32_t x = fold(phase);
+    return applySign(quarterTable[(x >> FRAC_BITS) + 1], phase);
+}
+
+inline float quarterLinear(uint32_t phase)
+{
+    const uint32_t x = fold(phase);
+    const float* t = &quarterTable[(x >> FRAC_BITS) + 1];
+    const float frac = float(x & ((1u << FRAC_BITS) - 1)) * FRAC_SCALE;
+
+    return applySign(math::lerp(t[0], t[1], frac), phase);
+}
+
+inline float quarterCubic(uint32_t phase)
+{
+    const uint32_t x = fold(phase);
+    const float* t = &quarterTable[x >> FRAC_BITS];
+    const float frac = float(x & ((1u << FRAC_BITS) - 1)) * FRAC_SCALE;
+
+    return applySign(math::lagr(t[0], t[1], t[2], t[3], frac), phase);
+}
+
+inline float polynomial(uint32_t phase)
+{
+    // Signed phase in [-0.5, 0.5) periods folded onto [-1, 1] quarter-waves
+    const float t = float(int32_t(phase)) * (1.0f / 4294967296.0f);
+    const float x = copysignf(1.0f - fabsf(1.0f - 4.0f * fabsf(t)), t);
+    const float x2 = x * x;
+
+    // sin(pi/2 * x), max error 6e-7
+    return x * (1.57079102f + x2 * (-0.645892944f + x2 * (0.0794345687f + x2 * -0.00433324284f)));
+}
+
+} // namespace sine
+
+//==============================================================================
+
+/// Sine of a 32-bit fixed point phase with the selected kernel.
+inline float sineLUT(uint32_t phase)
+{
+#if SINE_KERNEL == SINE_KERNEL_TABLE
+    return sine::table(phase);
+#elif SINE_KERNEL == SINE_KERNEL_QUARTER
+    return sine::quarter(phase);
+#elif SINE_KERNEL == SINE_KERNEL_QUARTER_LINEAR
+    return sine::quarterLinear(phase);
+#elif SINE_KERNEL == SINE_KERNEL_QUARTER_CUBIC
+    return sine::quarterCubic(phase);
+#elif SINE_KERNEL == SINE_KERNEL_POLYNOMIAL
+    return sine::polynomial(phase);
+#else
+#   error "Unknown SINE_KERNEL"
+#endif
+}
+
+/// Sine of a phase in periods.
+inline float sineLUT(float p)
+{
+    return sineLUT(sine::toPhase(p));
+}
+
+/// Cheaper sine without interpolation, the selected kernel when it does not interpolate.
+inline float fastSineLUT(uint32_t phase)
+{
+#if SINE_KERNEL_INTERPOLATES
+    return sine::quarter(phase);
+#else
+    return sineLUT(phase);
+#endif
+}
+
+inline float fastSineLUT(float p)
+{
+    return fastSineLUT(sine::toPhase(p));
+}
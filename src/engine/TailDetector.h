@@ -0,0 +1,87 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+/**
+ * @brief Puts an effect to sleep once its tail has died out.
+ *
+ * The effect reports the peak of its input before processing a block,
+ * and the peak of its wet signal after. Once both have stayed below
+ * the threshold for the hold time (at least the longest delay of the
+ * effect), the effect clears its state and sleeps: its blocks are
+ * bypassed until the input is no longer silent, which wakes it up
+ * within the same block.
+ */
+class TailDetector final
+{
+public:
+
+    /// Silence threshold, -100 dB.
+    constexpr static float DefaultThreshold = 1.0e-5f;
+
+    explicit TailDetector(float threshold = DefaultThreshold)
+        : m_threshold(threshold)
+        , m_silentFrames(0)
+        , m_inputSilent(true)
+        , m_sleeping(false)
+    {}
+
+    bool isSleeping() const noexcept { return m_sleeping; }
+
+    /// Peak absolute value of a stereo block.
+    static float peak(const float* left, const float* right, size_t numFrames)
+    {
+        float p = 0.0f;
+
+        for (size_t i = 0; i < numFrames; ++i)
+            p = std::max(p, std::max(fabsf(left[i]), fabsf(right[i])));
+
+        return p;
+    }
+
+    /**
+     * @brief Check the input of a block before processing it.
+     *
+     * Returns true if the effect sleeps and the input is silent,
+     * the block is to be bypassed.
+     */
+    bool skip(const float* inL, const float* inR, size_t numFrames)
+    {
+        m_inputSilent = peak(inL, inR, numFrames) <= m_threshold;
+
+        if (! m_inputSilent)
+            m_sleeping = false;
+
+        return m_sleeping;
+    }
+
+    /**
+     * @brief Account for the wet signal peak of a processed block.
+     *
+     * Returns true when the tail is over: the effect must clear its
+     * state, it sleeps from the next block.
+     */
+    bool update(float tailPeak, size_t numFrames, size_t holdFrames)
+    {
+        if (m_inputSilent && tailPeak <= m_threshold)
+            m_silentFrames += numFrames;
+        else
+            m_silentFrames = 0;
+
+        if (m_silentFrames < holdFrames)
+            return false;
+
+        m_silentFrames = 0;
+        m_sleeping = true;
+
+        return true;
+    }
+
+private:
+    float m_threshold;
+    size_t m_silentFrames;
+    bool m_inputSilent;
+    bool m_sleeping;
+};
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <array>
+#include <algorithm>
+#include <cstring>
 #include <Arduino.h>
 
 #include "engine/FastList.h"
@@ -38,8 +40,16 @@ public:
     int velocity() const noexcept { return m_velocity; }
 
     virtual void release() = 0;
+
+    /// Release within the given time (in seconds) instead of the patch release.
+    virtual void release(float time) = 0;
+
     virtual void reset() = 0;
     virtual void process(float* outL, float* outR, size_t numFrames) = 0;
+
+    /// Called once per instrument block, after the voice has been rendered.
+    virtual void endBlock() {}
+
     virtual bool shouldRecycle() = 0;
     virtual float envelopeLevel() const = 0;
 
@@ -93,7 +103,203 @@ public:
         m_idleVoices.append(voice);
     }
 
+    VoiceType* begin() { return m_voices.data(); }
+    VoiceType* end() { return m_voices.data() + size; }
+
+    VoiceType& operator[] (size_t index) { return m_voices[index]; }
+    size_t indexOf(const VoiceType* voice) const { return size_t(voice - m_voices.data()); }
+
 private:
     std::array<VoiceType, size> m_voices;
     List<VoiceType> m_idleVoices;
-};
\ No newline at end of file
+};
+//==============================================================================
+
+/**
+ * @brief Voice stealing policy.
+ */
+enum class VoiceStealing
+{
+    Quietest,       ///< Voice with the lowest envelope level.
+    Oldest,         ///< Voice triggered the longest time ago.
+    SameNoteFirst   ///< Voice playing the same note, otherwise the quietest one.
+};
+
+/**
+ * @brief Constant time lookup of the active voices.
+ *
+ * Voices are referred to by their VoicePool index. Every active voice
+ * is linked into the list of its key, into the list of its level
+ * bucket and into the list ordered by trigger time, so that note-off
+ * and voice stealing never scan all the active voices.
+ *
+ * Level buckets are 6 dB wide and are refreshed via setLevel()
+ * once per block, the quietest voice is then taken from the
+ * quietest non-empty bucket.
+ */
+template <size_t Polyphony>
+class VoiceIndex final
+{
+public:
+
+    using Index = uint16_t;
+
+    constexpr static Index none = 0xFFFF;
+    constexpr static size_t NUM_KEYS = 128;
+    constexpr static size_t NUM_LEVELS = 16;
+
+    static_assert(Polyphony < none, "Too many voices");
+
+    VoiceIndex()
+    {
+        m_voiceKey.fill(0);
+        m_voiceLevel.fill(0);
+        m_levelMask = 0;
+    }
+
+    /// Register a triggered voice.
+    void activate(Index voice, int key)
+    {
+        m_voiceKey[voice] = uint8_t(key);
+        append(m_keyLinks, m_keys[key], voice);
+
+        // Treat a just triggered voice as the loudest one until
+        // its level gets updated, otherwise it would be the
+        // first to steal within the same block.
+        m_voiceLevel[voice] = 0;
+        append(m_levelLinks, m_levels[0], voice);
+        m_levelMask |= 1u;
+
+        append(m_ageLinks, m_age, voice);
+    }
+
+    /// Remove a recycled or stolen voice.
+    void deactivate(Index voice)
+    {
+        remove(m_keyLinks, m_keys[m_voiceKey[voice]], voice);
+        removeLevel(voice);
+        remove(m_ageLinks, m_age, voice);
+    }
+
+    /// Update the voice envelope level.
+    void setLevel(Index voice, float level)
+    {
+        const uint8_t bucket = levelBucket(level);
+
+        if (bucket != m_voiceLevel[voice]) {
+            removeLevel(voice);
+            m_voiceLevel[voice] = bucket;
+            append(m_levelLinks, m_levels[bucket], voice);
+            m_levelMask |= 1u << bucket;
+        }
+    }
+
+    /// First active voice playing the key.
+    Index firstVoice(int key) const { return m_keys[key].head; }
+
+    /// Next active voice playing the same key.
+    Index nextVoice(Index voice) const { return m_keyLinks[voice].next; }
+
+    /// Voice to be stolen for a new note.
+    Index steal(VoiceStealing policy, int key) const
+    {
+        if (policy == VoiceStealing::SameNoteFirst && m_keys[key].head != none)
+            return m_keys[key].head;
+
+        if (policy == VoiceStealing::Oldest || m_levelMask == 0)
+            return m_age.head;
+
+        return m_levels[31 - __builtin_clz(m_levelMask)].head;
+    }
+
+    /// Call f(voice) for up to n active voices, the quietest first.
+    template <typename F>
+    void forEachQuietest(size_t n, F&& f) const
+    {
+        for (int bucket = NUM_LEVELS - 1; bucket >= 0 && n > 0; --bucket) {
+            for (auto voice = m_levels[bucket].head; voice != none && n > 0; voice = m_levelLinks[voice].next, --n)
+                f(voice);
+        }
+    }
+
+private:
+
+    struct Link
+    {
+        Index prev = none;
+        Index next = none;
+    };
+
+    struct IndexList
+    {
+        Index head = none;
+        Index tail = none;
+    };
+
+    using Links = std::array<Link, Polyphony>;
+
+    static void append(Links& links, IndexList& list, Index voice)
+    {
+        links[voice].prev = list.tail;
+        links[voice].next = none;
+
+        if (list.tail == none)
+            list.head = voice;
+        else
+            links[list.tail].next = voice;
+
+        list.tail = voice;
+    }
+
+    static void remove(Links& links, IndexList& list, Index voice)
+    {
+        const auto prev = links[voice].prev;
+        const auto next = links[voice].next;
+
+        if (prev == none)
+            list.head = next;
+        else
+            links[prev].next = next;
+
+        if (next == none)
+            list.tail = prev;
+        else
+            links[next].prev = prev;
+
+        links[voice].prev = none;
+        links[voice].next = none;
+    }
+
+    void removeLevel(Index voice)
+    {
+        const auto bucket = m_voiceLevel[voice];
+        remove(m_levelLinks, m_levels[bucket], voice);
+
+        if (m_levels[bucket].head == none)
+            m_levelMask &= ~(1u << bucket);
+    }
+
+    // 0 for the loudest bucket, one bucket per binary exponent.
+    static uint8_t levelBucket(float level)
+    {
+        uint32_t bits;
+        ::memcpy(&bits, &level, sizeof(bits));
+
+        const int exponent = int((bits >> 23) & 0xFF) - 127;
+
+        return uint8_t(std::min(std::max(-exponent, 0), int(NUM_LEVELS - 1)));
+    }
+
+    std::array<IndexList, NUM_KEYS> m_keys;
+    std::array<IndexList, NUM_LEVELS> m_levels;
+    IndexList m_age;
+
+    Links m_keyLinks;
+    Links m_levelLinks;
+    Links m_ageLinks;
+
+    std::array<uint8_t, Polyphony> m_voiceKey;
+    std::array<uint8_t, Polyphony> m_voiceLevel;
+
+    uint32_t m_levelMask;
+};
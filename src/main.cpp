@@ -5,6 +5,12 @@
 #include "engine/Engine.h"
 #include "engine/MidiMessage.h"
 #include "engine/AudioProcess.h"
+#include "engine/Profiler.h"
+#include "engine/Arena.h"
+
+#if defined(ENGINE_BENCHMARK)
+#   include "engine/Benchmark.h"
+#endif
 
 extern "C" {
     // These are to avoid linker undefined references error
@@ -69,6 +75,18 @@ namespace midi
 extern "C" int main(void) {
 	Serial.begin(115200);
 	Serial.println("Initialized");
+    mem::report([](const char* line) { Serial.println(line); });
+
+#if defined(ENGINE_BENCHMARK)
+    {
+        // Give the host some time to open the serial port.
+        delay(2000);
+
+        // Keep the audio interrupt out of the measurements.
+        Engine::AudioLock lock;
+        bench::run([](const char* line) { Serial.println(line); });
+    }
+#endif
 
     {
         Engine::AudioLock lock;
@@ -82,6 +100,10 @@ extern "C" int main(void) {
         MIDI.begin(MIDI_CHANNEL_OMNI);
     }
 
+#if defined(AUDIO_RENDER_AHEAD)
+    audioProcess.setRenderAhead(AUDIO_RENDER_AHEAD);
+#endif
+
     pinMode(13, OUTPUT);
 
     auto ts = millis();
@@ -96,12 +118,37 @@ extern "C" int main(void) {
         digitalWriteFast(13, sense);
 
         if (t >= 1000) {
-            Serial.printf("DSP Load: %f%%  Voices: %d, L: %f R: %f\r\n",
+            Serial.printf("DSP Load: %f%%  Quality level: %d, Voices: %d, Skipped ops: %u, MIDI overflows: %u, Sleeping fx: 0x%x, L: %f R: %f\r\n",
                 audioProcess.dspLoadPercent(),
+                audioProcess.qualityLevel(),
                 audioProcess.numActiveVoices(),
+                (unsigned) audioProcess.numSkippedOperatorBlocks(),
+                (unsigned) audioProcess.numMidiOverflows(),
+                (unsigned) audioProcess.sleepingEffects(),
                 audioProcess.amplitudeL(),
                 audioProcess.amplitudeR());
 
+            if (audioProcess.renderAhead() > 0) {
+                // How close the ring came to running dry during the last second
+                Serial.printf("Render ahead: %u blocks, min ready %u, underruns %u\r\n",
+                    (unsigned) audioProcess.renderAhead(),
+                    (unsigned) audioProcess.minRenderAheadBlocks(),
+                    (unsigned) audioProcess.numRenderAheadUnderruns());
+
+                audioProcess.resetRenderAheadStats();
+            }
+
+#if defined(ENGINE_PROFILING)
+            // Take a snapshot so that the audio interrupt is not held while printing.
+            perf::Profiler profile;
+            {
+                Engine::AudioLock lock;
+                profile = perf::Profiler::instance();
+                perf::Profiler::instance().reset();
+            }
+            profile.report([](const char* line) { Serial.println(line); });
+#endif
+
             ts += t;
         }
     }
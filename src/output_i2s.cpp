@@ -36,7 +36,35 @@ uint16_t  AudioOutputI2S::block_left_offset = 0;
 uint16_t  AudioOutputI2S::block_right_offset = 0;
 bool AudioOutputI2S::update_responsibility = false;
 DMAChannel AudioOutputI2S::dma(false);
-DMAMEM __attribute__((aligned(32))) static uint32_t i2s_tx_buffer[AUDIO_BLOCK_SAMPLES];
+#if defined(AUDIO_OUTPUT_24BIT) && !defined(AUDIO_OUTPUT_DIRECT)
+#error "AUDIO_OUTPUT_24BIT requires AUDIO_OUTPUT_DIRECT"
+#endif
+#if defined(AUDIO_OUTPUT_DIRECT)
+#if !defined(KINETISK) && !defined(__IMXRT1062__)
+#error "AUDIO_OUTPUT_DIRECT is not supported on this board"
+#endif
+// Each half holds a whole block, rendered in place by the update
+#if defined(AUDIO_OUTPUT_24BIT)
+#define I2S_TX_BUFFER_SIZE (AUDIO_BLOCK_SAMPLES * 4)
+#else
+#define I2S_TX_BUFFER_SIZE (AUDIO_BLOCK_SAMPLES * 2)
+#endif
+void * volatile AudioOutputI2S::direct_buffer = NULL;
+#else
+#define I2S_TX_BUFFER_SIZE AUDIO_BLOCK_SAMPLES
+#endif
+#if defined(AUDIO_OUTPUT_24BIT)
+// Whole 32-bit slots, the sample is left-justified
+#define I2S_TX_WORD_SIZE 4
+#define I2S_TX_DMA_SIZE 2
+#define I2S_TX_DATA_OFFSET 0
+#else
+// 16-bit samples into the upper half of the 32-bit slots
+#define I2S_TX_WORD_SIZE 2
+#define I2S_TX_DMA_SIZE 1
+#define I2S_TX_DATA_OFFSET 2
+#endif
+DMAMEM __attribute__((aligned(32))) static uint32_t i2s_tx_buffer[I2S_TX_BUFFER_SIZE];
 
 #if defined(__IMXRT1062__)
 #include "utility/imxrt_hw.h"
@@ -55,15 +83,15 @@ void AudioOutputI2S::begin(void)
 	CORE_PIN22_CONFIG = PORT_PCR_MUX(6); // pin 22, PTC1, I2S0_TXD0
 
 	dma.TCD->SADDR = i2s_tx_buffer;
-	dma.TCD->SOFF = 2;
-	dma.TCD->ATTR = DMA_TCD_ATTR_SSIZE(1) | DMA_TCD_ATTR_DSIZE(1);
-	dma.TCD->NBYTES_MLNO = 2;
+	dma.TCD->SOFF = I2S_TX_WORD_SIZE;
+	dma.TCD->ATTR = DMA_TCD_ATTR_SSIZE(I2S_TX_DMA_SIZE) | DMA_TCD_ATTR_DSIZE(I2S_TX_DMA_SIZE);
+	dma.TCD->NBYTES_MLNO = I2S_TX_WORD_SIZE;
 	dma.TCD->SLAST = -sizeof(i2s_tx_buffer);
-	dma.TCD->DADDR = (void *)((uint32_t)&I2S0_TDR0 + 2);
+	dma.TCD->DADDR = (void *)((uint32_t)&I2S0_TDR0 + I2S_TX_DATA_OFFSET);
 	dma.TCD->DOFF = 0;
-	dma.TCD->CITER_ELINKNO = sizeof(i2s_tx_buffer) / 2;
+	dma.TCD->CITER_ELINKNO = sizeof(i2s_tx_buffer) / I2S_TX_WORD_SIZE;
 	dma.TCD->DLASTSGA = 0;
-	dma.TCD->BITER_ELINKNO = sizeof(i2s_tx_buffer) / 2;
+	dma.TCD->BITER_ELINKNO = sizeof(i2s_tx_buffer) / I2S_TX_WORD_SIZE;
 	dma.TCD->CSR = DMA_TCD_CSR_INTHALF | DMA_TCD_CSR_INTMAJOR;
 	dma.triggerAtHardwareEvent(DMAMUX_SOURCE_I2S0_TX);
 	dma.enable();
@@ -74,16 +102,16 @@ void AudioOutputI2S::begin(void)
 #elif defined(__IMXRT1062__)
 	CORE_PIN7_CONFIG  = 3;  //1:TX_DATA0
 	dma.TCD->SADDR = i2s_tx_buffer;
-	dma.TCD->SOFF = 2;
-	dma.TCD->ATTR = DMA_TCD_ATTR_SSIZE(1) | DMA_TCD_ATTR_DSIZE(1);
-	dma.TCD->NBYTES_MLNO = 2;
+	dma.TCD->SOFF = I2S_TX_WORD_SIZE;
+	dma.TCD->ATTR = DMA_TCD_ATTR_SSIZE(I2S_TX_DMA_SIZE) | DMA_TCD_ATTR_DSIZE(I2S_TX_DMA_SIZE);
+	dma.TCD->NBYTES_MLNO = I2S_TX_WORD_SIZE;
 	dma.TCD->SLAST = -sizeof(i2s_tx_buffer);
 	dma.TCD->DOFF = 0;
-	dma.TCD->CITER_ELINKNO = sizeof(i2s_tx_buffer) / 2;
+	dma.TCD->CITER_ELINKNO = sizeof(i2s_tx_buffer) / I2S_TX_WORD_SIZE;
 	dma.TCD->DLASTSGA = 0;
-	dma.TCD->BITER_ELINKNO = sizeof(i2s_tx_buffer) / 2;
+	dma.TCD->BITER_ELINKNO = sizeof(i2s_tx_buffer) / I2S_TX_WORD_SIZE;
 	dma.TCD->CSR = DMA_TCD_CSR_INTHALF | DMA_TCD_CSR_INTMAJOR;
-	dma.TCD->DADDR = (void *)((uint32_t)&I2S1_TDR0 + 2);
+	dma.TCD->DADDR = (void *)((uint32_t)&I2S1_TDR0 + I2S_TX_DATA_OFFSET);
 	dma.triggerAtHardwareEvent(DMAMUX_SOURCE_SAI1_TX);
 	dma.enable();
 
@@ -91,8 +119,45 @@ void AudioOutputI2S::begin(void)
 	I2S1_TCSR = I2S_TCSR_TE | I2S_TCSR_BCE | I2S_TCSR_FRDE;
 #endif
 	update_responsibility = update_setup();
+#if defined(AUDIO_OUTPUT_DIRECT)
+	dma.attachInterrupt(isr_direct);
+#else
 	dma.attachInterrupt(isr);
+#endif
+}
+
+#if defined(AUDIO_OUTPUT_DIRECT)
+// Called on every half of the buffer. The update renders straight into
+// the half that has just been played, no blocks are queued or copied.
+void AudioOutputI2S::isr_direct(void)
+{
+	void *dest;
+	uint32_t saddr;
+
+	saddr = (uint32_t)(dma.TCD->SADDR);
+	dma.clearInterrupt();
+
+	if (saddr < (uint32_t)i2s_tx_buffer + sizeof(i2s_tx_buffer) / 2) {
+		// DMA is transmitting the first half of the buffer
+		// so we must fill the second half
+		dest = &i2s_tx_buffer[I2S_TX_BUFFER_SIZE/2];
+	} else {
+		// DMA is transmitting the second half of the buffer
+		// so we must fill the first half
+		dest = i2s_tx_buffer;
+	}
+
+	if (AudioStream::update_pending) {
+		// The previous block is still being rendered.
+		memset(dest, 0, sizeof(i2s_tx_buffer) / 2);
+		arm_dcache_flush_delete(dest, sizeof(i2s_tx_buffer) / 2);
+		return;
+	}
+
+	direct_buffer = dest;
+	if (AudioOutputI2S::update_responsibility) AudioStream::update_all();
 }
+#endif
 
 
 void AudioOutputI2S::isr(void)
@@ -38,6 +38,12 @@ public:
 	virtual void update(void);
 	void begin(void);
 	friend class AudioInputI2S;
+#if defined(AUDIO_OUTPUT_DIRECT)
+	// Half of the DMA buffer to be filled by the current update:
+	// AUDIO_BLOCK_SAMPLES interleaved L R frames, see AudioProcess.
+	// Samples are int16_t, or int32_t with AUDIO_OUTPUT_24BIT.
+	static void * directBuffer(void) { return direct_buffer; }
+#endif
 protected:
 	AudioOutputI2S(int dummy): AudioStream(2, inputQueueArray) {} // to be used only inside AudioOutputI2Sslave !!
 	static void config_i2s(void);
@@ -46,6 +52,10 @@ protected:
 	static bool update_responsibility;
 	static DMAChannel dma;
 	static void isr(void);
+#if defined(AUDIO_OUTPUT_DIRECT)
+	static void isr_direct(void);
+	static void * volatile direct_buffer;
+#endif
 private:
 	static audio_block_t *block_left_2nd;
 	static audio_block_t *block_right_2nd;